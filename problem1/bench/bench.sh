@@ -0,0 +1,73 @@
+#!/bin/sh
+#
+#  bench.sh - throughput benchmark of the word counter
+#
+#  Runs ../main over a corpus for every input mode and number of workers and writes a CSV line per run with
+#  the best elapsed time of the repetitions, the throughput in MB/s, the speedup over one worker in the same
+#  mode and the parallel efficiency (speedup / workers). The first number of workers of the list is the
+#  baseline of the speedup, counted as if it scaled perfectly when it is not 1.
+#
+#  Modes: monitor (-b), chunk (-p), uring (-p -i uring) and stream (the corpus piped to -).
+#
+#  Eduardo Santos and Pedro Bastos - April 2022
+
+usage() {
+  echo "usage: $0 [-m main] [-c corpus] [-t \"1 2 4 8\"] [-x \"monitor chunk uring stream\"] [-r repeats] [-o out.csv]" >&2
+  exit 1
+}
+
+dir=$(dirname "$0")
+main="$dir/../main"
+corpus="corpus"
+threads="1 2 4 8"
+modes="monitor chunk uring stream"
+repeats=3
+out="bench.csv"
+
+while getopts "m:c:t:x:r:o:h" opt; do
+  case $opt in
+    m) main=$OPTARG ;;
+    c) corpus=$OPTARG ;;
+    t) threads=$OPTARG ;;
+    x) modes=$OPTARG ;;
+    r) repeats=$OPTARG ;;
+    o) out=$OPTARG ;;
+    *) usage ;;
+  esac
+done
+
+[ -x "$main" ] || { echo "$0: $main not found, compile it first" >&2; exit 1; }
+files=$(ls "$corpus"/*.txt 2>/dev/null) || { echo "$0: no corpus in $corpus, run genCorpus first" >&2; exit 1; }
+bytes=$(cat $files | wc -c)
+
+# elapsed time of one run, in seconds
+run() {
+  mode=$1; n=$2
+  case $mode in
+    monitor) "$main" -b -n "$n" $files ;;
+    chunk)   "$main" -b -p -n "$n" $files ;;
+    uring)   "$main" -b -p -i uring -n "$n" $files ;;
+    stream)  cat $files | "$main" -b -n "$n" - ;;
+  esac 2>/dev/null | sed -n 's/^Elapsed time = \([0-9.]*\) s$/\1/p'
+}
+
+echo "mode,threads,bytes,seconds,mb_per_s,speedup,efficiency" > "$out"
+
+for mode in $modes; do
+  base=""
+  for n in $threads; do
+    best=""
+    i=0
+    while [ $i -lt "$repeats" ]; do
+      t=$(run "$mode" "$n")
+      [ -n "$t" ] && best=$(echo "$best $t" | awk '{ if (NF == 1 || $2 < $1) print $NF; else print $1 }')
+      i=$((i + 1))
+    done
+    [ -z "$best" ] && { echo "$0: $mode with $n workers failed" >&2; continue; }
+    [ -z "$base" ] && base=$(echo "$best $n" | awk '{ print $1 * $2 }')          # time of one worker, scaled
+    echo "$mode $n $bytes $best $base" | awk '{
+      speedup = $5 / $4;
+      printf "%s,%d,%d,%.6f,%.3f,%.3f,%.3f\n", $1, $2, $3, $4, $3 / $4 / 1000000.0, speedup, speedup / $2
+    }' | tee -a "$out"
+  done
+done
@@ -0,0 +1,283 @@
+/**
+ *  \file genCorpus.c (implementation file)
+ *
+ *  \brief Problem name: Total number of words, number of words beginning with a vowel and ending with a consonant.
+ *
+ *  Synthetic corpus generator.
+ *  Writes a set of UTF-8 text files for the throughput benchmarks. The output only depends on the options, the
+ *  seed included, so a corpus can be generated again anywhere instead of being copied around. The options set
+ *  the total size, the number of files and how the size is shared among them, the share of words written
+ *  with multibyte letters and the rate of apostrophes and dashes.
+ *
+ *  \author Eduardo Santos and Pedro Bastos - April 2022
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <libgen.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+/** \brief size of the output buffer of each file */
+#define OUT_BUFFER   (1 << 16)
+
+/** \brief file size distributions */
+#define DIST_EQUAL   0
+#define DIST_ZIPF    1
+
+/** \brief ASCII letters */
+static const char *ascii_vowels = "aeiouAEIOU";
+static const char *ascii_consonants = "bcdfghjklmnpqrstvwxyzBCDFGHJKLMNPQRSTVWXYZ";
+
+/** \brief multibyte letters, vowels and consonants with diacritics and a few letters of other scripts */
+static const char *mb_vowels[] = { "á", "à", "â", "ã", "é", "è", "ê", "í", "ì", "ó", "ò", "ô", "õ", "ú", "ù", "ü",
+                                   "Á", "É", "Í", "Ó", "Ú" };
+static const char *mb_consonants[] = { "ç", "Ç", "ñ", "Ñ" };
+static const char *mb_others[] = { "α", "β", "ж", "я", "ש", "日", "本" };
+
+/** \brief separators, with their weights */
+static const char *separators[] = { " ", " ", " ", " ", " ", " ", "\n", ", ", ". ", "; ", ": ", "! ", "? ",
+                                    " «", "» ", " “", "” ", " (", ") ", " [", "] ", "… " };
+
+/** \brief apostrophes and dashes */
+static const char *apostrophes[] = { "'", "’", "‘" };
+static const char *dashes[] = { "-", "–", "—" };
+
+/** \brief state of the pseudo-random generator */
+static uint64_t rng_state;
+
+/**
+ *  \brief Next value of a xorshift64* generator, the same on every platform.
+ *
+ *  \return pseudo-random 64 bit value.
+ */
+
+static uint64_t next_random(void) {
+  rng_state ^= rng_state >> 12;
+  rng_state ^= rng_state << 25;
+  rng_state ^= rng_state >> 27;
+  return rng_state * 0x2545F4914F6CDD1Dull;
+}
+
+/**
+ *  \brief Uniform value in [0, 1).
+ *
+ *  \return pseudo-random value.
+ */
+
+static double uniform(void) {
+  return (next_random() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/**
+ *  \brief Uniform index in [0, n).
+ *
+ *  \param n number of values.
+ *  \return pseudo-random index.
+ */
+
+static int pick(int n) {
+  return (int)(next_random() % (uint64_t)n);
+}
+
+/** \brief output of the file being written */
+static struct {
+  FILE *fp;
+  char buf[OUT_BUFFER];
+  size_t len;
+  long written;
+} out;
+
+/**
+ *  \brief Append a string to the file being written.
+ *
+ *  \param s string.
+ */
+
+static void emit(const char *s) {
+  size_t n = strlen(s);
+
+  if (out.len + n > OUT_BUFFER) {
+    fwrite(out.buf, 1, out.len, out.fp);
+    out.len = 0;
+  }
+  memcpy(out.buf + out.len, s, n);
+  out.len += n;
+  out.written += n;
+}
+
+/**
+ *  \brief Append a letter.
+ *
+ *  \param vowel 1 for a vowel, 0 for a consonant.
+ *  \param multibyte 1 if the word is written with multibyte letters.
+ */
+
+static void emit_letter(int vowel, int multibyte) {
+  char ascii[2] = { 0, 0 };
+
+  if (multibyte && uniform() < 0.4) {
+    if (uniform() < 0.15)
+      emit(mb_others[pick(sizeof(mb_others) / sizeof(mb_others[0]))]);
+    else if (vowel)
+      emit(mb_vowels[pick(sizeof(mb_vowels) / sizeof(mb_vowels[0]))]);
+    else
+      emit(mb_consonants[pick(sizeof(mb_consonants) / sizeof(mb_consonants[0]))]);
+    return;
+  }
+
+  ascii[0] = vowel ? ascii_vowels[pick(strlen(ascii_vowels))] : ascii_consonants[pick(strlen(ascii_consonants))];
+  emit(ascii);
+}
+
+/**
+ *  \brief Append a word of 1 to 12 letters, alternating vowels and consonants loosely.
+ *
+ *  \param mb_rate share of words with multibyte letters.
+ *  \param apos_rate probability of an apostrophe inside the word.
+ *  \param dash_rate probability of a dash inside the word.
+ */
+
+static void emit_word(double mb_rate, double apos_rate, double dash_rate) {
+  int len = 1 + pick(6) + pick(7);
+  int multibyte = uniform() < mb_rate;
+  int vowel = uniform() < 0.45;
+
+  for (int i = 0; i < len; i++) {
+    if (i > 0 && i < len - 1) {
+      if (uniform() < apos_rate)
+        emit(apostrophes[pick(sizeof(apostrophes) / sizeof(apostrophes[0]))]);
+      else if (uniform() < dash_rate)
+        emit(dashes[pick(sizeof(dashes) / sizeof(dashes[0]))]);
+    }
+    emit_letter(vowel, multibyte);
+    vowel = (uniform() < 0.7) ? !vowel : vowel;
+  }
+}
+
+/**
+ *  \brief Parse a size with an optional K, M or G suffix.
+ *
+ *  \param s text of the size.
+ *  \return size in bytes, or -1 if it is not valid.
+ */
+
+static long long parse_size(const char *s) {
+  char *end;
+  double v = strtod(s, &end);
+
+  switch (*end) {
+    case 'k': case 'K': v *= 1024.0; end++; break;
+    case 'm': case 'M': v *= 1024.0 * 1024.0; end++; break;
+    case 'g': case 'G': v *= 1024.0 * 1024.0 * 1024.0; end++; break;
+  }
+
+  return (*end != '\0' || v < 0) ? -1 : (long long)v;
+}
+
+/** \brief Prints command usage */
+static void printUsage(char *cmdName)
+{
+  fprintf(stderr, "\nSynopsis: %s OPTIONS\n"
+                  "  OPTIONS:\n"
+                  "  -h      --- print this help\n"
+                  "  -o      --- output directory (default: corpus)\n"
+                  "  -s      --- total size, with an optional K, M or G suffix (default: 64M)\n"
+                  "  -n      --- number of files (default: 1)\n"
+                  "  -d      --- size distribution of the files: equal or zipf (default: equal)\n"
+                  "  -m      --- share of words with multibyte letters, 0 to 1 (default: 0.2)\n"
+                  "  -a      --- rate of apostrophes inside words, 0 to 1 (default: 0.02)\n"
+                  "  -k      --- rate of dashes inside words, 0 to 1 (default: 0.01)\n"
+                  "  -r      --- seed of the generator (default: 1)\n",
+          cmdName);
+}
+
+/**
+ *  \brief Main thread.
+ *
+ *  Its role is parsing the options and writing the files of the corpus, one after the other.
+ */
+int main(int argc, char *argv[]) {
+  char *dir = "corpus";                                                                   /* output directory */
+  long long total = 64LL << 20;                                                          /* total size in bytes */
+  int num_files = 1;                                                                         /* number of files */
+  int dist = DIST_EQUAL;                                                               /* size distribution */
+  double mb_rate = 0.2, apos_rate = 0.02, dash_rate = 0.01;                                /* text mix */
+  unsigned long long seed = 1;                                                                    /* seed */
+  double weight_sum = 0.0;
+  char path[4096];
+  int opt;
+
+  while ((opt = getopt(argc, argv, "ho:s:n:d:m:a:k:r:")) != -1) {
+    switch (opt) {
+      case 'o': dir = optarg; break;
+      case 's': total = parse_size(optarg); break;
+      case 'n': num_files = atoi(optarg); break;
+      case 'd':
+        if (strcmp(optarg, "equal") == 0)
+          dist = DIST_EQUAL;
+        else if (strcmp(optarg, "zipf") == 0)
+          dist = DIST_ZIPF;
+        else
+          dist = -1;
+        break;
+      case 'm': mb_rate = atof(optarg); break;
+      case 'a': apos_rate = atof(optarg); break;
+      case 'k': dash_rate = atof(optarg); break;
+      case 'r': seed = strtoull(optarg, NULL, 10); break;
+      case 'h':
+        printUsage(basename(argv[0]));
+        return EXIT_SUCCESS;
+      default:
+        printUsage(basename(argv[0]));
+        return EXIT_FAILURE;
+    }
+  }
+
+  if (total < 0 || num_files < 1 || dist < 0 || mb_rate < 0 || mb_rate > 1 || apos_rate < 0 || apos_rate > 1
+      || dash_rate < 0 || dash_rate > 1) {
+    fprintf(stderr, "%s: invalid option value\n", basename(argv[0]));
+    printUsage(basename(argv[0]));
+    return EXIT_FAILURE;
+  }
+
+  if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+    perror("error on creating the output directory");
+    return EXIT_FAILURE;
+  }
+
+  /* the i-th file gets a share of the total proportional to its weight */
+  for (int i = 0; i < num_files; i++)
+    weight_sum += (dist == DIST_ZIPF) ? 1.0 / (i + 1) : 1.0;
+
+  rng_state = seed * 0x9E3779B97F4A7C15ull + 1;                                  /* never zero */
+
+  for (int i = 0; i < num_files; i++) {
+    double weight = (dist == DIST_ZIPF) ? 1.0 / (i + 1) : 1.0;
+    long long target = (long long)(total * weight / weight_sum);
+
+    snprintf(path, sizeof(path), "%s/corpus_%05d.txt", dir, i);
+    if ((out.fp = fopen(path, "wb")) == NULL) {
+      perror("error on creating a file");
+      return EXIT_FAILURE;
+    }
+    out.len = 0;
+    out.written = 0;
+
+    while (out.written < target) {
+      emit_word(mb_rate, apos_rate, dash_rate);
+      emit(separators[pick(sizeof(separators) / sizeof(separators[0]))]);
+    }
+
+    fwrite(out.buf, 1, out.len, out.fp);
+    if (fclose(out.fp) != 0) {
+      perror("error on writing a file");
+      return EXIT_FAILURE;
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,403 @@
+/**
+ *  \file chunks.c (implementation file)
+ *
+ *  \brief Problem name: Total number of words, number of words beginning with a vowel and ending with a consonant.
+ *
+ *  Lock-free chunk mode.
+ *  Every file is split in byte ranges of about CHUNK_SIZE bytes and each (file, chunk) pair is an independent
+ *  task. The workers take the tasks from their own deques of the work-stealing scheduler, so several files are
+ *  open at once and no worker waits for the others to open or close a file. Each chunk is counted into a private,
+ *  cache-line padded result; the worker that finishes the last chunk of a file merges its results in order,
+ *  stores them in the results arrays and releases the file.
+ *
+ *  Files of a single chunk are packed in batches of about BATCH_SIZE bytes, a batch being a single task: its
+ *  worker counts the files one after the other, so thousands of small files cost a task each batch rather
+ *  than a task each file. Larger files are still split among the workers.
+ *
+ *  A file is memory mapped by the first worker that needs it, unless the input engine loaded it already, and the
+ *  workers decode straight from its contents.
+ *
+ *  Definition of the operations carried out by the workers:
+ *     \li get_chunk_task
+ *     \li count_chunk_task.
+ *
+ *  Definition of the operations carried out by the main thread:
+ *     \li init_chunks
+ *     \li free_chunks.
+ *
+ *  \author Eduardo Santos and Pedro Bastos - April 2022
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "probConst.h"
+#include "wordCount.h"
+#include "fileReader.h"
+#include "ioEngine.h"
+#include "resumeState.h"
+#include "scheduler.h"
+#include "textStats.h"
+#include "wordFreq.h"
+
+/** \brief array of the filenames retrieved from the main file */
+extern char **filenames;
+
+/** \brief variable to save the number of files */
+extern int num_files;
+
+/** \brief array to save the total number of words for each file */
+extern long *array_num_words;
+
+/** \brief array to save the number of words beginning with a vowel for each file */
+extern long *array_num_vowels;
+
+/** \brief array to save the number of words ending with a consonant for each file */
+extern long *array_num_cons;
+
+/** \brief array to save the number of bytes read from each file */
+extern long *array_num_bytes;
+
+/** \brief array to save the number of words counted from the bytes read from each file in this run */
+extern long *array_run_words;
+
+/** \brief array to flag the files that could not be read to their end, whose counts are partial */
+extern int *array_incomplete;
+
+/** \brief array to flag the workers that met a file they could not open */
+extern int *worker_failed;
+
+/** \brief array to save the extended statistics of each file, NULL when they are off */
+extern TextStats *array_text_stats;
+
+/** \brief number of most frequent words reported, 0 when they are off */
+extern int top_words;
+
+/** \brief file being counted by the workers */
+typedef struct {
+  MappedFile map;                                                                     /* contents of the file */
+  pthread_mutex_t open_lock;                                          /* serializes the opening of the file */
+  int opened;                                                                     /* 1 once map is valid */
+  int first_slot;                                                   /* result slot of the first chunk */
+  int num_chunks;                                                                       /* number of chunks */
+  int chunks_left;                                                      /* chunks not counted yet, atomic */
+  size_t start;                                              /* offset resumed from, 0 unless resuming */
+  CountState start_state;                                                      /* counting state at start */
+} FileJob;
+
+/** \brief a chunk of a file, or a batch of small files */
+typedef struct {
+  int file_index;                                              /* file, or first entry of batch_files */
+  int chunk;                                                                         /* chunk of the file */
+  int num_files;                                                   /* files of the batch, 0 for a chunk */
+} ChunkTask;
+
+/** \brief files being counted */
+static FileJob *file_jobs;
+
+/** \brief number of files being counted */
+static int num_jobs;
+
+/** \brief every task, the chunks of each file consecutive and in order */
+static ChunkTask *tasks;
+
+/** \brief number of tasks */
+static int num_tasks;
+
+/** \brief files of the batches, each batch consecutive */
+static int *batch_files;
+
+/** \brief number of chunks of all the files, a result slot each */
+static int num_slots;
+
+/** \brief result of each chunk */
+static ChunkResult *chunk_results;
+
+/** \brief extended statistics of each chunk, NULL when they are off */
+static ChunkStats *chunk_stats = NULL;
+
+/** \brief words crossing the ends of each chunk, NULL when the most frequent words are off */
+static WordChunk *chunk_words = NULL;
+
+/**
+ *  \brief List the chunks of every file and pack the small files in batches.
+ *
+ *  Operation carried out by the main thread. Only the sizes are read here, the files are opened by the
+ *  workers when their first chunk is counted.
+ *
+ *  \return 1 for Success and 0 for Failure.
+ */
+
+int init_chunks(void) {
+  struct stat st;
+  long size, batch_bytes = 0;
+  long *sizes;
+  int num_batched = 0, batch_start = 0;
+
+  num_jobs = num_files;
+  file_jobs = calloc(num_jobs, sizeof(FileJob));
+  sizes = malloc((num_jobs + 1) * sizeof(long));
+  num_slots = 0;
+
+  for (int i = 0; i < num_files; i++) {
+    if (stat(filenames[i], &st) != 0) {
+      fprintf(stderr, "Error! File %s not found.\n", filenames[i]);
+      return 0;
+    }
+
+    /* a pipe has no size, it is counted as a single chunk */
+    size = S_ISREG(st.st_mode) ? st.st_size : 0;
+    file_jobs[i].start = get_resume_point(i, size, &file_jobs[i].start_state);
+    size -= file_jobs[i].start;
+    sizes[i] = size;
+    file_jobs[i].num_chunks = (size + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    if (file_jobs[i].num_chunks == 0)
+      file_jobs[i].num_chunks = 1;
+    file_jobs[i].chunks_left = file_jobs[i].num_chunks;
+    file_jobs[i].first_slot = num_slots;
+    pthread_mutex_init(&file_jobs[i].open_lock, NULL);
+    num_slots += file_jobs[i].num_chunks;
+  }
+
+  tasks = malloc((num_slots + 1) * sizeof(ChunkTask));
+  batch_files = malloc((num_jobs + 1) * sizeof(int));
+  if (posix_memalign((void **)&chunk_results, CACHE_LINE, (size_t)num_slots * sizeof(ChunkResult)) != 0) {
+    perror("error on allocating chunk results");
+    return 0;
+  }
+  if (array_text_stats != NULL
+      && posix_memalign((void **)&chunk_stats, CACHE_LINE, (size_t)num_slots * sizeof(ChunkStats)) != 0) {
+    perror("error on allocating chunk statistics");
+    return 0;
+  }
+  if (top_words > 0 && (chunk_words = malloc((size_t)num_slots * sizeof(WordChunk))) == NULL) {
+    perror("error on allocating chunk words");
+    return 0;
+  }
+
+  /* a batch is closed once it holds BATCH_SIZE bytes or BATCH_MAX_FILES files */
+  num_tasks = 0;
+  for (int i = 0; i < num_files; i++) {
+    if (file_jobs[i].num_chunks == 1) {
+      batch_files[num_batched++] = i;
+      batch_bytes += sizes[i];
+      if (batch_bytes >= BATCH_SIZE || num_batched - batch_start == BATCH_MAX_FILES) {
+        tasks[num_tasks++] = (ChunkTask){ batch_start, 0, num_batched - batch_start };
+        batch_start = num_batched;
+        batch_bytes = 0;
+      }
+      continue;
+    }
+
+    for (int j = 0; j < file_jobs[i].num_chunks; j++)
+      tasks[num_tasks++] = (ChunkTask){ i, j, 0 };
+  }
+  if (num_batched > batch_start)
+    tasks[num_tasks++] = (ChunkTask){ batch_start, 0, num_batched - batch_start };
+
+  free(sizes);
+
+  return init_scheduler(num_tasks);
+}
+
+/**
+ *  \brief Hand out the next task.
+ *
+ *  Operation carried out by the workers.
+ *
+ *  \param id worker identification.
+ *  \return index of the task, or -1 when every task was counted or is being counted.
+ */
+
+int get_chunk_task(unsigned int id) {
+  return get_task(id);
+}
+
+/**
+ *  \brief Make the contents of a file available, once.
+ *
+ *  A file that cannot be opened is flagged as incomplete and fails the worker that tried.
+ *
+ *  \param id worker identification.
+ *  \param job file.
+ *  \param file_index index of the file.
+ */
+
+static void open_file_job(unsigned int id, FileJob *job, int file_index) {
+  pthread_mutex_lock(&job->open_lock);
+
+  if (!job->opened) {
+    if (!io_open_file(file_index, &job->map)) {
+      perror("error on opening file");
+      array_incomplete[file_index] = 1;
+      worker_failed[id] = 1;
+      job->map.data = NULL;
+      job->map.size = 0;
+      job->map.mapped = 0;
+    }
+    __atomic_store_n(&job->opened, 1, __ATOMIC_RELEASE);
+  }
+
+  pthread_mutex_unlock(&job->open_lock);
+}
+
+/**
+ *  \brief Merge the words crossing the chunks of a file and collect the ones left.
+ *
+ *  \param id worker identification.
+ *  \param file_index index of the file.
+ *  \param limit end of the bytes counted in chunks.
+ */
+
+static void merge_file_words(unsigned int id, int file_index, size_t limit) {
+  FileJob *job = &file_jobs[file_index];
+  CountState state;
+  WordToken tok = { .len = 0, .cut = 0 };
+
+  if (job->start <= job->map.size)
+    state = job->start_state;
+  else
+    init_count_state(&state);
+
+  for (int j = 0; j < job->num_chunks; j++)
+    merge_chunk_words(id, file_index, &state, &tok, &chunk_words[job->first_slot + j]);
+
+  count_buffer_words(id, file_index, &state, &tok, job->map.data + limit, job->map.size - limit);
+  finish_word(file_index, &state, &tok);
+}
+
+/**
+ *  \brief Merge the chunk results of a file into the results arrays.
+ *
+ *  \param id worker identification.
+ *  \param file_index index of the file.
+ */
+
+static void merge_file(unsigned int id, int file_index) {
+  FileJob *job = &file_jobs[file_index];
+  size_t limit = resume_limit(job->map.data, job->map.size);
+  TextStats *stats = (array_text_stats != NULL) ? &array_text_stats[file_index] : NULL;
+  CountState state;
+
+  if (job->start <= job->map.size)
+    state = job->start_state;
+  else
+    init_count_state(&state);
+
+  /* chunks are merged in file order, each one fixing up the word that crosses its start */
+  for (int j = 0; j < job->num_chunks; j++)
+    if (stats != NULL)
+      merge_chunk_stats(&state, stats, &chunk_results[job->first_slot + j], &chunk_stats[job->first_slot + j]);
+    else
+      merge_chunk(&state, &chunk_results[job->first_slot + j]);
+
+  set_resume_point(file_index, job->map.data, limit, &state);
+
+  /* a sequence cut by the end of the file, left out of the resume point */
+  if (stats != NULL) {
+    count_buffer_stats(&state, stats, job->map.data + limit, job->map.size - limit);
+    finish_text_stats(&state, stats);
+  }
+  else
+    count_buffer(&state, job->map.data + limit, job->map.size - limit);
+
+  array_num_words[file_index] = state.total_num_words;
+  array_num_vowels[file_index] = state.num_vowels;
+  array_num_cons[file_index] = state.num_cons;
+  array_num_bytes[file_index] = job->map.size - ((job->start <= job->map.size) ? job->start : 0);
+  array_run_words[file_index] = state.total_num_words
+                                - ((job->start <= job->map.size) ? job->start_state.total_num_words : 0);
+
+  if (chunk_words != NULL)
+    merge_file_words(id, file_index, limit);
+
+  io_close_file(file_index, &job->map);
+}
+
+/**
+ *  \brief Count a chunk of a file.
+ *
+ *  The nominal range of the chunk is moved forward so that no UTF-8 sequence is split, and counted straight
+ *  from the mapped file into the private result slot of the chunk. The worker counting the last chunk of a
+ *  file merges the file.
+ *
+ *  \param id worker identification.
+ *  \param file_index index of the file.
+ *  \param j chunk of the file.
+ */
+
+static void count_file_chunk(unsigned int id, int file_index, int j) {
+  FileJob *job = &file_jobs[file_index];
+  int slot = job->first_slot + j;
+  size_t size, base, start, end;
+
+  if (!__atomic_load_n(&job->opened, __ATOMIC_ACQUIRE))
+    open_file_job(id, job, file_index);
+
+  /* a file that shrank below its resume point is counted again from the start */
+  size = resume_limit(job->map.data, job->map.size);
+  base = (job->start <= job->map.size) ? job->start : 0;
+  start = (j == 0) ? base : align_chunk(job->map.data, size, base + (size_t)j * CHUNK_SIZE);
+  end = (j == job->num_chunks - 1) ? size : align_chunk(job->map.data, size, base + (size_t)(j + 1) * CHUNK_SIZE);
+  if (start > size)                                                     /* file shrank since it was listed */
+    start = size;
+  if (end > size)
+    end = size;
+  if (end < start)
+    end = start;
+
+  if (chunk_stats != NULL)
+    count_chunk_stats(job->map.data + start, end - start, &chunk_results[slot], &chunk_stats[slot]);
+  else
+    count_chunk(job->map.data + start, end - start, &chunk_results[slot]);
+
+  /* the words are collected in a pass of their own, the counting may take the SIMD path */
+  if (chunk_words != NULL)
+    scan_chunk_words(id, file_index, job->map.data + start, end - start, &chunk_words[slot]);
+
+  /* the last chunk to finish sees the results of all the others */
+  if (__atomic_sub_fetch(&job->chunks_left, 1, __ATOMIC_ACQ_REL) == 0)
+    merge_file(id, file_index);
+}
+
+/**
+ *  \brief Count the chunk of a task, or every file of a batch.
+ *
+ *  Operation carried out by the workers. The files of a batch have a single chunk each, so each one is
+ *  counted, merged and released by the worker of the batch without waiting for any other.
+ *
+ *  \param id worker identification.
+ *  \param t index of the task.
+ */
+
+void count_chunk_task(unsigned int id, int t) {
+  if (tasks[t].num_files == 0) {
+    count_file_chunk(id, tasks[t].file_index, tasks[t].chunk);
+    return;
+  }
+
+  for (int k = 0; k < tasks[t].num_files; k++)
+    count_file_chunk(id, batch_files[tasks[t].file_index + k], 0);
+}
+
+/**
+ *  \brief Release the tasks.
+ *
+ *  Operation carried out by the main thread, after the workers have terminated.
+ */
+
+void free_chunks(void) {
+  free_scheduler();
+
+  for (int i = 0; i < num_jobs; i++)
+    pthread_mutex_destroy(&file_jobs[i].open_lock);
+
+  free(chunk_words);
+  free(chunk_stats);
+  free(chunk_results);
+  free(batch_files);
+  free(tasks);
+  free(file_jobs);
+}
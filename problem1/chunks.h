@@ -0,0 +1,37 @@
+/**
+ *  \file chunks.h (interface file)
+ *
+ *  \brief Problem name: Total number of words, number of words beginning with a vowel and ending with a consonant.
+ *
+ *  Lock-free chunk mode.
+ *  Every file is split in byte ranges of about CHUNK_SIZE bytes and each (file, chunk) pair is an independent
+ *  task pulled by the workers, so several files are open at once. The worker that finishes the last chunk of
+ *  a file merges its results in order.
+ *
+ *  Definition of the operations carried out by the workers:
+ *     \li get_chunk_task
+ *     \li count_chunk_task.
+ *
+ *  Definition of the operations carried out by the main thread:
+ *     \li init_chunks
+ *     \li free_chunks.
+ *
+ *  \author Eduardo Santos and Pedro Bastos - April 2022
+ */
+
+#ifndef CHUNKS_H_
+#define CHUNKS_H_
+
+/** \brief List the chunks of every file and pack the small files in batches. */
+extern int init_chunks(void);
+
+/** \brief Hand out the next task. */
+extern int get_chunk_task(unsigned int id);
+
+/** \brief Count the chunk of a task, or every file of a batch. */
+extern void count_chunk_task(unsigned int id, int t);
+
+/** \brief Release the tasks. */
+extern void free_chunks(void);
+
+#endif /* CHUNKS_H_ */
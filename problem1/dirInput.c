@@ -0,0 +1,152 @@
+/**
+ *  \file dirInput.c (implementation file)
+ *
+ *  \brief Problem name: Total number of words, number of words beginning with a vowel and ending with a consonant.
+ *
+ *  Directory input.
+ *  A directory given as input is walked recursively, each directory in name order, and replaced in the list of
+ *  files by the regular files found, so the order of the files is the same from run to run. Symbolic links to
+ *  regular files are followed; links to directories are not, so a link cannot make the walk loop, and other
+ *  kinds of files (pipes, sockets, devices) under a directory are left out. Files named directly are kept as
+ *  they are.
+ *
+ *  Definition of the operations carried out by the main thread:
+ *     \li expand_directories.
+ *
+ *  \author Eduardo Santos and Pedro Bastos - April 2022
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "dirInput.h"
+
+/** \brief array of the filenames retrieved from the main file */
+extern char **filenames;
+
+/** \brief variable to save the number of files */
+extern int num_files;
+
+/** \brief list of files being built */
+static char **found;
+
+/** \brief number of files in found */
+static int num_found;
+
+/** \brief size of found */
+static int found_cap;
+
+/**
+ *  \brief Add a file to the list being built.
+ *
+ *  \param name file name, kept by the list.
+ *  \return 1 for Success and 0 for Failure.
+ */
+
+static int add_found(char *name) {
+  if (num_found == found_cap) {
+    char **grown = realloc(found, (found_cap *= 2) * sizeof(char *));
+
+    if (grown == NULL) {
+      perror("error on listing the files");
+      return 0;
+    }
+    found = grown;
+  }
+  found[num_found++] = name;
+
+  return 1;
+}
+
+/**
+ *  \brief Skip the "." and ".." entries of a directory.
+ */
+
+static int not_dot(const struct dirent *entry) {
+  return strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0;
+}
+
+/**
+ *  \brief Add the regular files under a directory, in name order.
+ *
+ *  \param dir path of the directory.
+ *  \return 1 for Success and 0 for Failure.
+ */
+
+static int walk_directory(const char *dir) {
+  struct dirent **entries;
+  struct stat st;
+  char *path;
+  int n, ok = 1;
+
+  if ((n = scandir(dir, &entries, not_dot, alphasort)) < 0) {
+    fprintf(stderr, "Error! Directory %s cannot be read.\n", dir);
+    return 0;
+  }
+
+  for (int i = 0; i < n; i++) {
+    if (ok) {
+      path = malloc(strlen(dir) + strlen(entries[i]->d_name) + 2);
+      sprintf(path, "%s%s%s", dir, (dir[strlen(dir) - 1] == '/') ? "" : "/", entries[i]->d_name);
+
+      if (lstat(path, &st) == 0 && S_ISDIR(st.st_mode)) {
+        ok = walk_directory(path);
+        free(path);
+      }
+      else if (stat(path, &st) == 0 && S_ISREG(st.st_mode))                              /* links followed */
+        ok = add_found(path);
+      else
+        free(path);
+    }
+    free(entries[i]);
+  }
+  free(entries);
+
+  return ok;
+}
+
+/**
+ *  \brief Replace every directory of the list of files by the regular files under it.
+ *
+ *  Operation carried out by the main thread, before the files are looked at by anything else.
+ *
+ *  \return 1 for Success and 0 for Failure.
+ */
+
+int expand_directories(void) {
+  struct stat st;
+  int dirs = 0;
+
+  for (int i = 0; i < num_files; i++)
+    if (stat(filenames[i], &st) == 0 && S_ISDIR(st.st_mode))
+      dirs++;
+  if (dirs == 0)
+    return 1;
+
+  found_cap = num_files + 64;
+  num_found = 0;
+  if ((found = malloc(found_cap * sizeof(char *))) == NULL) {
+    perror("error on listing the files");
+    return 0;
+  }
+
+  for (int i = 0; i < num_files; i++) {
+    if (stat(filenames[i], &st) == 0 && S_ISDIR(st.st_mode)) {
+      if (!walk_directory(filenames[i]))
+        return 0;
+    }
+    else if (!add_found(filenames[i]))
+      return 0;
+  }
+
+  free(filenames);
+  filenames = found;
+  num_files = num_found;
+
+  printf("Directory input: %d files\n", num_files);
+
+  return 1;
+}
@@ -0,0 +1,21 @@
+/**
+ *  \file dirInput.h (interface file)
+ *
+ *  \brief Problem name: Total number of words, number of words beginning with a vowel and ending with a consonant.
+ *
+ *  Directory input.
+ *  A directory given as input stands for every regular file under it.
+ *
+ *  Definition of the operations carried out by the main thread:
+ *     \li expand_directories.
+ *
+ *  \author Eduardo Santos and Pedro Bastos - April 2022
+ */
+
+#ifndef DIRINPUT_H_
+#define DIRINPUT_H_
+
+/** \brief Replace every directory of the list of files by the regular files under it. */
+extern int expand_directories(void);
+
+#endif /* DIRINPUT_H_ */
@@ -0,0 +1,140 @@
+/**
+ *  \file fileReader.c (implementation file)
+ *
+ *  \brief Problem name: Total number of words, number of words beginning with a vowel and ending with a consonant.
+ *
+ *  Zero-copy input.
+ *  Regular files are memory mapped and decoded straight from the page cache; pipes and other non-regular
+ *  files are read with large read() calls into a private buffer.
+ *
+ *  Definition of the operations:
+ *     \li map_file
+ *     \li unmap_file.
+ *
+ *  \author Eduardo Santos and Pedro Bastos - April 2022
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "fileReader.h"
+
+/** \brief size of each read() when the file cannot be mapped */
+#define READ_BLOCK   (1 << 20)
+
+/**
+ *  \brief Read a non-regular file until its end.
+ *
+ *  \param fd file descriptor.
+ *  \param mf where the contents are stored.
+ *  \return 1 for Success and 0 for Failure.
+ */
+
+static int read_file(int fd, MappedFile *mf) {
+  size_t cap = READ_BLOCK;
+  ssize_t n;
+
+  mf->mapped = 0;
+  mf->size = 0;
+  if ((mf->data = malloc(cap)) == NULL)
+    return 0;
+
+  for (;;) {
+    if (cap - mf->size < READ_BLOCK) {                                              /* keep room for a block */
+      unsigned char *grown = realloc(mf->data, cap *= 2);
+      if (grown == NULL) {
+        free(mf->data);
+        return 0;
+      }
+      mf->data = grown;
+    }
+
+    if ((n = read(fd, mf->data + mf->size, READ_BLOCK)) < 0) {
+      if (errno == EINTR)
+        continue;
+      free(mf->data);
+      return 0;
+    }
+    if (n == 0)                                                                                     /* EOF */
+      break;
+    mf->size += n;
+  }
+
+  return 1;
+}
+
+/**
+ *  \brief Make the contents of a file available in memory.
+ *
+ *  A regular file is mapped read-only and the kernel is told it will be read sequentially, backed by huge
+ *  pages where the system allows it. Anything else is read into a buffer.
+ *
+ *  \param name file name.
+ *  \param mf where the contents are stored.
+ *  \return 1 for Success and 0 for Failure.
+ */
+
+int map_file(const char *name, MappedFile *mf) {
+  struct stat st;
+  int fd;
+  int ok = 1;
+
+  if ((fd = open(name, O_RDONLY)) < 0)
+    return 0;
+
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return 0;
+  }
+
+  if (!S_ISREG(st.st_mode))
+    ok = read_file(fd, mf);
+
+  else if (st.st_size == 0) {                                                      /* nothing to map */
+    mf->data = NULL;
+    mf->size = 0;
+    mf->mapped = 0;
+  }
+
+  else {
+    mf->size = st.st_size;
+    mf->mapped = 1;
+    mf->data = mmap(NULL, mf->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mf->data == MAP_FAILED) {
+      lseek(fd, 0, SEEK_SET);                                                   /* map refused, read it */
+      ok = read_file(fd, mf);
+    }
+    else {
+      madvise(mf->data, mf->size, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+      madvise(mf->data, mf->size, MADV_HUGEPAGE);                     /* only a hint, may be refused */
+#endif
+    }
+  }
+
+  close(fd);
+
+  return ok;
+}
+
+/**
+ *  \brief Release the contents of a file.
+ *
+ *  \param mf contents returned by map_file.
+ */
+
+void unmap_file(MappedFile *mf) {
+  if (mf->mapped)
+    munmap(mf->data, mf->size);
+  else
+    free(mf->data);
+
+  mf->data = NULL;
+  mf->size = 0;
+  mf->mapped = 0;
+}
@@ -0,0 +1,35 @@
+/**
+ *  \file fileReader.h (interface file)
+ *
+ *  \brief Problem name: Total number of words, number of words beginning with a vowel and ending with a consonant.
+ *
+ *  Zero-copy input.
+ *  Regular files are memory mapped and decoded straight from the page cache; pipes and other non-regular
+ *  files are read with large read() calls into a private buffer.
+ *
+ *  Definition of the operations:
+ *     \li map_file
+ *     \li unmap_file.
+ *
+ *  \author Eduardo Santos and Pedro Bastos - April 2022
+ */
+
+#ifndef FILEREADER_H_
+#define FILEREADER_H_
+
+#include <stddef.h>
+
+/** \brief contents of an input file */
+typedef struct {
+  unsigned char *data;                                                           /* first byte of the file */
+  size_t size;                                                                    /* number of bytes */
+  int mapped;                                           /* 1 if data is a mapping, 0 if it is a malloc buffer */
+} MappedFile;
+
+/** \brief Make the contents of a file available in memory. */
+extern int map_file(const char *name, MappedFile *mf);
+
+/** \brief Release the contents of a file. */
+extern void unmap_file(MappedFile *mf);
+
+#endif /* FILEREADER_H_ */
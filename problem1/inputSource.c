@@ -0,0 +1,262 @@
+/**
+ *  \file inputSource.c (implementation file)
+ *
+ *  \brief Problem name: Total number of words, number of words beginning with a vowel and ending with a consonant.
+ *
+ *  Input sources of the streaming mode.
+ *  The kind of a file is told by its name: "-" is the standard input, a name ending in .gz is decompressed with
+ *  zlib and one ending in .zst with libzstd; any other file is read as it is. A compressed file may hold several
+ *  members (gzip) or frames (zstd) one after the other, which are read as one stream of bytes. The compressed
+ *  bytes are read DECODE_READ_SIZE at a time and decompressed straight into the buffer of the caller.
+ *
+ *  gzip needs zlib (-lz); add -DNO_ZLIB to the compile line to leave it out. zstd is only built with -DWITH_ZSTD
+ *  and -lzstd. A file of a kind left out is reported and read as empty.
+ *
+ *  Definition of the operations carried out by the readers:
+ *     \li open_source
+ *     \li read_source
+ *     \li close_source.
+ *
+ *  Definition of the operations carried out by the main thread:
+ *     \li is_compressed.
+ *
+ *  \author Eduardo Santos and Pedro Bastos - April 2022
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#ifndef NO_ZLIB
+#include <zlib.h>
+#endif
+#ifdef WITH_ZSTD
+#include <zstd.h>
+#endif
+
+#include "probConst.h"
+#include "inputSource.h"
+
+/**
+ *  \brief Tell whether a name ends with a suffix.
+ */
+
+static int has_suffix(const char *name, const char *suffix) {
+  size_t n = strlen(name), k = strlen(suffix);
+
+  return n > k && strcmp(name + n - k, suffix) == 0;
+}
+
+/**
+ *  \brief Tell whether a file is read through a decompressor.
+ *
+ *  Operation carried out by the main thread, to pick the streaming mode.
+ *
+ *  \param name file name.
+ *  \return 1 for a .gz or .zst file.
+ */
+
+int is_compressed(const char *name) {
+  return has_suffix(name, ".gz") || has_suffix(name, ".zst");
+}
+
+/**
+ *  \brief Read from a descriptor, retrying when interrupted.
+ *
+ *  \return bytes read, 0 at the end of the file or -1 on error.
+ */
+
+static ssize_t read_fd(int fd, unsigned char *buf, size_t len) {
+  ssize_t n;
+
+  while ((n = read(fd, buf, len)) < 0 && errno == EINTR)
+    ;
+
+  return n;
+}
+
+/**
+ *  \brief Open a file for reading as plain bytes.
+ *
+ *  Operation carried out by the readers.
+ *
+ *  \param name file name, "-" for the standard input.
+ *  \param src where the source is stored.
+ *  \return 1 for Success and 0 for Failure.
+ */
+
+int open_source(const char *name, InputSource *src) {
+  memset(src, 0, sizeof(InputSource));
+  src->name = name;
+  src->kind = has_suffix(name, ".gz") ? SOURCE_GZIP : has_suffix(name, ".zst") ? SOURCE_ZSTD : SOURCE_PLAIN;
+
+  if (strcmp(name, "-") == 0)
+    src->fd = STDIN_FILENO;
+  else if ((src->fd = open(name, O_RDONLY)) < 0) {
+    fprintf(stderr, "Error! File %s cannot be opened.\n", name);
+    return 0;
+  }
+  else
+    posix_fadvise(src->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+  switch (src->kind) {
+    case SOURCE_GZIP:
+#ifndef NO_ZLIB
+      if ((src->decoder = gzdopen(src->fd, "rb")) == NULL) {
+        perror("error on starting the gzip decoder");
+        break;
+      }
+      gzbuffer(src->decoder, DECODE_READ_SIZE);
+      /* zlib copies data without a gzip header as it is, which a .gz file must not hold */
+      if (gzdirect(src->decoder)) {
+        fprintf(stderr, "Error! %s is not a gzip file.\n", name);
+        break;
+      }
+      return 1;
+#else
+      fprintf(stderr, "Error! %s: gzip support was left out of this build.\n", name);
+      break;
+#endif
+
+    case SOURCE_ZSTD:
+#ifdef WITH_ZSTD
+      if ((src->decoder = ZSTD_createDCtx()) == NULL || (src->in = malloc(DECODE_READ_SIZE)) == NULL) {
+        perror("error on starting the zstd decoder");
+        break;
+      }
+      return 1;
+#else
+      fprintf(stderr, "Error! %s: zstd support was left out of this build.\n", name);
+      break;
+#endif
+
+    default:
+      return 1;
+  }
+
+  close_source(src);
+  return 0;
+}
+
+#ifdef WITH_ZSTD
+/**
+ *  \brief Decompress the next bytes of a zstd file.
+ *
+ *  Input is read only once the decoder has no output left from the input it has, so that the end of the file
+ *  is not taken for the end of the stream while output is pending. The bytes decompressed before damaged data
+ *  is found are returned first and the error on the next call.
+ *
+ *  \return bytes decompressed, 0 at the end of the file or -1 on error.
+ */
+
+static ssize_t read_zstd(InputSource *src, unsigned char *buf, size_t len) {
+  ZSTD_outBuffer out = { buf, len, 0 };
+  ZSTD_inBuffer in;
+  ssize_t n;
+  size_t r;
+
+  while (out.pos < out.size && !src->failed) {
+    if (src->in_pos == src->in_len && !src->flushing) {
+      if ((n = read_fd(src->fd, src->in, DECODE_READ_SIZE)) < 0) {
+        perror("error on reading a compressed file");
+        return -1;
+      }
+      if (n == 0) {
+        if (src->frame_left != 0) {
+          fprintf(stderr, "Error! %s: truncated zstd frame.\n", src->name);
+          src->failed = 1;
+        }
+        break;
+      }
+      src->in_len = n;
+      src->in_pos = 0;
+    }
+
+    in.src = src->in;
+    in.size = src->in_len;
+    in.pos = src->in_pos;
+    r = ZSTD_decompressStream(src->decoder, &out, &in);
+    src->in_pos = in.pos;
+    if (ZSTD_isError(r)) {
+      fprintf(stderr, "Error! %s: %s.\n", src->name, ZSTD_getErrorName(r));
+      src->failed = 1;
+      break;
+    }
+    src->frame_left = r;
+    src->flushing = (out.pos == out.size);
+  }
+
+  return (out.pos == 0 && src->failed) ? -1 : (ssize_t)out.pos;
+}
+#endif
+
+/**
+ *  \brief Read the next plain bytes of a file.
+ *
+ *  Operation carried out by the readers. Fewer bytes than asked may be returned before the end of the file.
+ *
+ *  \param src source.
+ *  \param buf where the bytes are stored.
+ *  \param len size of buf.
+ *  \return bytes read, 0 at the end of the file or -1 on error.
+ */
+
+ssize_t read_source(InputSource *src, unsigned char *buf, size_t len) {
+  ssize_t n;
+
+  switch (src->kind) {
+#ifndef NO_ZLIB
+    case SOURCE_GZIP:
+      if ((n = gzread(src->decoder, buf, (unsigned int)len)) <= 0) {                /* a cut file ends early */
+        int err;
+        const char *msg = gzerror(src->decoder, &err);
+
+        if (err != Z_OK) {
+          if (strstr(msg, ": ") != NULL)                                          /* drop the "<fd:N>: " prefix */
+            msg = strstr(msg, ": ") + 2;
+          fprintf(stderr, "Error! %s: %s.\n", src->name, msg);
+          return -1;
+        }
+      }
+      return n;
+#endif
+
+#ifdef WITH_ZSTD
+    case SOURCE_ZSTD:
+      return read_zstd(src, buf, len);
+#endif
+
+    default:
+      if ((n = read_fd(src->fd, buf, len)) < 0)
+        perror("error on reading the stream");
+      return n;
+  }
+}
+
+/**
+ *  \brief Close a file.
+ *
+ *  Operation carried out by the readers. The standard input is left open.
+ *
+ *  \param src source.
+ */
+
+void close_source(InputSource *src) {
+#ifndef NO_ZLIB
+  if (src->kind == SOURCE_GZIP && src->decoder != NULL) {
+    gzclose(src->decoder);                                                            /* closes the descriptor */
+    return;
+  }
+#endif
+#ifdef WITH_ZSTD
+  if (src->kind == SOURCE_ZSTD) {
+    ZSTD_freeDCtx(src->decoder);
+    free(src->in);
+  }
+#endif
+  if (src->fd != STDIN_FILENO)
+    close(src->fd);
+}
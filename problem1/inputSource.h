@@ -0,0 +1,58 @@
+/**
+ *  \file inputSource.h (interface file)
+ *
+ *  \brief Problem name: Total number of words, number of words beginning with a vowel and ending with a consonant.
+ *
+ *  Input sources of the streaming mode.
+ *  A file is read as a stream of plain bytes whether it is the standard input, a plain file or a file
+ *  compressed with gzip (.gz) or zstd (.zst), which is decompressed as it is read.
+ *
+ *  Definition of the operations carried out by the readers:
+ *     \li open_source
+ *     \li read_source
+ *     \li close_source.
+ *
+ *  Definition of the operations carried out by the main thread:
+ *     \li is_compressed.
+ *
+ *  \author Eduardo Santos and Pedro Bastos - April 2022
+ */
+
+#ifndef INPUTSOURCE_H_
+#define INPUTSOURCE_H_
+
+#include <stddef.h>
+#include <sys/types.h>
+
+/** \brief kinds of sources */
+#define SOURCE_PLAIN   0
+#define SOURCE_GZIP    1
+#define SOURCE_ZSTD    2
+
+/** \brief a file being read */
+typedef struct {
+  const char *name;                                                                              /* file name */
+  int kind;                                                                              /* SOURCE_* kind */
+  int fd;                                                                           /* descriptor of the file */
+  void *decoder;                                                   /* decompression state, NULL for plain */
+  unsigned char *in;                                                       /* compressed bytes read, zstd */
+  size_t in_len;                                                                 /* bytes in in, zstd */
+  size_t in_pos;                                                              /* bytes of in decoded, zstd */
+  size_t frame_left;                                           /* 0 at the end of a frame, zstd */
+  int flushing;                                         /* 1 while the decoder may hold output, zstd */
+  int failed;                                              /* 1 once the data was found damaged, zstd */
+} InputSource;
+
+/** \brief Tell whether a file is read through a decompressor. */
+extern int is_compressed(const char *name);
+
+/** \brief Open a file for reading as plain bytes. */
+extern int open_source(const char *name, InputSource *src);
+
+/** \brief Read the next plain bytes of a file. */
+extern ssize_t read_source(InputSource *src, unsigned char *buf, size_t len);
+
+/** \brief Close a file. */
+extern void close_source(InputSource *src);
+
+#endif /* INPUTSOURCE_H_ */
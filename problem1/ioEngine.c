@@ -0,0 +1,786 @@
+/**
+ *  \file ioEngine.c (implementation file)
+ *
+ *  \brief Problem name: Total number of words, number of words beginning with a vowel and ending with a consonant.
+ *
+ *  Input engine.
+ *  The files are loaded ahead of the workers, in file order, into buffers the workers count from. Two engines
+ *  are available:
+ *     \li io_uring: a single thread keeps up to IO_QUEUE_DEPTH opens and reads of IO_READ_SIZE bytes queued in
+ *         an io_uring submission queue, set up with raw system calls, and finishes the files as their reads
+ *         complete;
+ *     \li pread: IO_THREADS threads each open a file and read it with pread calls, then take the next one.
+ *
+ *  The files loaded and not released yet by the workers add up to at most IO_WINDOW bytes. Files bigger than
+ *  IO_PREFETCH_MAX, non-regular files and files a worker reaches before the engine are opened by the worker
+ *  itself, through map_file, as without an engine. A worker that reaches a file the engine is loading waits
+ *  for it; that time is the I/O wait reported at the end.
+ *
+ *  The io_uring engine needs <linux/io_uring.h>; add -DNO_IO_URING to the compile line to leave it out. When
+ *  the kernel refuses the ring the pread engine is used.
+ *
+ *  Definition of the operations carried out by the workers:
+ *     \li io_open_file
+ *     \li io_close_file.
+ *
+ *  Definition of the operations carried out by the main thread:
+ *     \li init_io_engine
+ *     \li print_io_stats
+ *     \li free_io_engine.
+ *
+ *  \author Eduardo Santos and Pedro Bastos - April 2022
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#if defined(__linux__) && !defined(NO_IO_URING) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define HAVE_IO_URING
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
+#endif
+
+#include "probConst.h"
+#include "fileReader.h"
+#include "ioEngine.h"
+
+/** \brief array of the filenames retrieved from the main file */
+extern char **filenames;
+
+/** \brief variable to save the number of files */
+extern int num_files;
+
+/** \brief file states */
+#define FILE_IDLE      0                                                     /* not reached by the engine yet */
+#define FILE_OWN       1                                                    /* left to the worker that opens it */
+#define FILE_LOADING   2                                                          /* being loaded by the engine */
+#define FILE_READY     3                                                          /* loaded, waiting for a worker */
+#define FILE_TAKEN     4                                                                 /* handed to a worker */
+#define FILE_DONE      5                                                             /* released by the worker */
+
+/** \brief a file as seen by the engine */
+typedef struct {
+  MappedFile map;                                                               /* contents, once loaded */
+  size_t size;                                                                   /* size when listed */
+  int state;                                                                                /* FILE_* state */
+} IoFile;
+
+/** \brief files as seen by the engine, NULL without an engine */
+static IoFile *io_files = NULL;
+
+/** \brief number of files seen by the engine */
+static int num_io_files;
+
+/** \brief engine in use */
+static int engine_kind = IO_NONE;
+
+/** \brief next file the engine may load */
+static int next_file = 0;
+
+/** \brief bytes of the files being loaded or loaded and not released */
+static long window_bytes = 0;
+
+/** \brief number of files being loaded */
+static int files_in_flight = 0;
+
+/** \brief flag that tells the engine threads to stop */
+static int io_stop = 0;
+
+/** \brief engine threads */
+static pthread_t *io_threads;
+
+/** \brief number of engine threads */
+static int num_io_threads = 0;
+
+/** \brief locking flag which warrants mutual exclusion on the file states */
+static pthread_mutex_t io_access = PTHREAD_MUTEX_INITIALIZER;
+
+/** \brief condition which warrants that a file being loaded is ready */
+static pthread_cond_t file_ready;
+
+/** \brief condition which warrants that the window has room for another file */
+static pthread_cond_t window_free;
+
+/** \brief statistics of the engine */
+static long files_loaded = 0;                                               /* files loaded by the engine */
+static long bytes_loaded = 0;                                                   /* bytes loaded by the engine */
+static long depth_peak = 0;                                                   /* most operations in flight */
+static long depth_sum = 0;                                             /* operations in flight, summed */
+static long depth_samples = 0;                                                   /* number of samples */
+static long engine_ns = 0;                                            /* time the engine waited for the I/O */
+static long worker_ns = 0;                                      /* time the workers waited for the engine */
+static long worker_waits = 0;                                     /* number of times a worker had to wait */
+
+/**
+ *  \brief Time elapsed between two instants, in nanoseconds.
+ *
+ *  \param begin first instant.
+ *  \param finish second instant.
+ *  \return nanoseconds.
+ */
+
+static long elapsed_ns(const struct timespec *begin, const struct timespec *finish) {
+  return (finish->tv_sec - begin->tv_sec) * 1000000000L + (finish->tv_nsec - begin->tv_nsec);
+}
+
+/**
+ *  \brief Record the number of operations in flight. Called with io_access held.
+ *
+ *  \param depth operations in flight.
+ */
+
+static void sample_depth(long depth) {
+  if (depth > depth_peak)
+    depth_peak = depth;
+  depth_sum += depth;
+  depth_samples++;
+}
+
+/**
+ *  \brief Take the next file to load, in file order.
+ *
+ *  Operation carried out by the engine threads. A file that does not fit in the window waits for the workers
+ *  to release others, unless the caller cannot wait.
+ *
+ *  \param may_wait 1 if the caller may wait for room in the window.
+ *  \return index of the file, -1 when there are no files left or -2 when the window is full.
+ */
+
+static int claim_next(int may_wait) {
+  int i = -1;
+
+  pthread_mutex_lock(&io_access);
+
+  while (next_file < num_io_files && !io_stop) {
+    IoFile *f = &io_files[next_file];
+
+    if (f->state != FILE_IDLE) {                                              /* opened by a worker already */
+      next_file++;
+      continue;
+    }
+
+    if (window_bytes > 0 && window_bytes + (long)f->size > IO_WINDOW) {
+      if (!may_wait) {
+        i = -2;
+        break;
+      }
+      pthread_cond_wait(&window_free, &io_access);
+      continue;
+    }
+
+    f->state = FILE_LOADING;
+    window_bytes += f->size;
+    files_in_flight++;
+    if (engine_kind == IO_PREAD)
+      sample_depth(files_in_flight);
+    i = next_file++;
+    break;
+  }
+
+  pthread_mutex_unlock(&io_access);
+
+  return i;
+}
+
+/**
+ *  \brief Hand a loaded file over to the workers.
+ *
+ *  Operation carried out by the engine threads. A file that could not be loaded is left to the worker that
+ *  reaches it, which reports the error.
+ *
+ *  \param i index of the file.
+ *  \param ok 1 if the file was loaded.
+ *  \param map contents of the file.
+ *  \param ns time spent waiting for the I/O of the file.
+ */
+
+static void publish_file(int i, int ok, const MappedFile *map, long ns) {
+  IoFile *f = &io_files[i];
+
+  pthread_mutex_lock(&io_access);
+
+  if (ok) {
+    f->map = *map;
+    f->state = FILE_READY;
+    files_loaded++;
+    bytes_loaded += map->size;
+  }
+  else {
+    f->state = FILE_OWN;
+    window_bytes -= f->size;
+    pthread_cond_broadcast(&window_free);
+  }
+  files_in_flight--;
+  engine_ns += ns;
+
+  pthread_cond_broadcast(&file_ready);
+  pthread_mutex_unlock(&io_access);
+}
+
+/**
+ *  \brief Load a file with pread calls.
+ *
+ *  \param i index of the file.
+ *  \param map where the contents are stored.
+ *  \return 1 for Success and 0 for Failure.
+ */
+
+static int load_pread(int i, MappedFile *map) {
+  size_t size = io_files[i].size;
+  ssize_t n;
+  int fd;
+
+  if ((fd = open(filenames[i], O_RDONLY)) < 0)
+    return 0;
+
+  map->data = NULL;
+  map->size = 0;
+  map->mapped = 0;
+  if (size > 0 && (map->data = malloc(size)) == NULL) {
+    close(fd);
+    return 0;
+  }
+
+  while (map->size < size) {
+    n = pread(fd, map->data + map->size, (size - map->size < IO_READ_SIZE) ? size - map->size : IO_READ_SIZE,
+              map->size);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      free(map->data);
+      close(fd);
+      return 0;
+    }
+    if (n == 0)                                                               /* file shrank since it was listed */
+      break;
+    map->size += n;
+  }
+
+  close(fd);
+
+  return 1;
+}
+
+/**
+ *  \brief Function of the threads of the pread engine.
+ *
+ *  Its role is to load files until there are no more.
+ *
+ *  \param par unused
+ */
+
+static void *pread_loader(void *par) {
+  struct timespec begin, finish;
+  MappedFile map;
+  int i, ok;
+
+  while ((i = claim_next(1)) >= 0) {
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    ok = load_pread(i, &map);
+    clock_gettime(CLOCK_MONOTONIC, &finish);
+    publish_file(i, ok, &map, elapsed_ns(&begin, &finish));
+  }
+
+  return NULL;
+}
+
+#ifdef HAVE_IO_URING
+
+/** \brief rings shared with the kernel */
+static struct {
+  int fd;                                                                          /* ring descriptor */
+  unsigned char *sq_ptr, *cq_ptr;                                                      /* ring mappings */
+  size_t sq_size, cq_size;                                                           /* sizes of the mappings */
+  struct io_uring_sqe *sqes;                                                         /* submission entries */
+  size_t sqes_size;                                                        /* size of the entries mapping */
+  unsigned *sq_tail, *sq_mask, *sq_array;                                                 /* submission ring */
+  unsigned *cq_head, *cq_tail, *cq_mask;                                                  /* completion ring */
+  struct io_uring_cqe *cqes;                                                         /* completion entries */
+  unsigned to_submit;                                                        /* entries queued, not submitted */
+} ring;
+
+/** \brief kinds of operation */
+#define OP_OPEN   0
+#define OP_READ   1
+
+/** \brief a file being loaded through the ring */
+typedef struct {
+  int file;                                                                  /* index of the file, -1 if free */
+  int fd;                                                                         /* -1 until opened */
+  MappedFile map;                                                                      /* buffer of the file */
+  size_t next_off;                                                                /* next byte to queue */
+  size_t eof_at;                                                                  /* end found by a read */
+  int pending;                                                                       /* operations in flight */
+  int failed;                                                                    /* 1 if an operation failed */
+} RingSlot;
+
+/** \brief an operation in flight, its index is the user data of the entry */
+typedef struct {
+  int kind;                                                                             /* OP_OPEN or OP_READ */
+  int slot;                                                                                  /* file of the operation */
+  size_t off;                                                                           /* offset of the read */
+  unsigned len;                                                                         /* length of the read */
+} RingOp;
+
+/**
+ *  \brief Set up a ring with the io_uring system calls.
+ *
+ *  \param entries number of submission entries.
+ *  \return 1 for Success and 0 for Failure.
+ */
+
+static int ring_setup(unsigned entries) {
+  struct io_uring_params p;
+
+  memset(&p, 0, sizeof(p));
+  if ((ring.fd = (int)syscall(__NR_io_uring_setup, entries, &p)) < 0)
+    return 0;
+
+  ring.sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+  ring.cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+  if (p.features & IORING_FEAT_SINGLE_MMAP) {                                 /* both rings in one mapping */
+    if (ring.cq_size > ring.sq_size)
+      ring.sq_size = ring.cq_size;
+    ring.cq_size = 0;
+  }
+
+  ring.sq_ptr = mmap(NULL, ring.sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.fd,
+                     IORING_OFF_SQ_RING);
+  if (ring.sq_ptr == MAP_FAILED) {
+    close(ring.fd);
+    return 0;
+  }
+
+  ring.cq_ptr = ring.sq_ptr;
+  if (ring.cq_size > 0) {
+    ring.cq_ptr = mmap(NULL, ring.cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.fd,
+                       IORING_OFF_CQ_RING);
+    if (ring.cq_ptr == MAP_FAILED) {
+      munmap(ring.sq_ptr, ring.sq_size);
+      close(ring.fd);
+      return 0;
+    }
+  }
+
+  ring.sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+  ring.sqes = mmap(NULL, ring.sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.fd,
+                   IORING_OFF_SQES);
+  if (ring.sqes == MAP_FAILED) {
+    if (ring.cq_size > 0)
+      munmap(ring.cq_ptr, ring.cq_size);
+    munmap(ring.sq_ptr, ring.sq_size);
+    close(ring.fd);
+    return 0;
+  }
+
+  ring.sq_tail = (unsigned *)(ring.sq_ptr + p.sq_off.tail);
+  ring.sq_mask = (unsigned *)(ring.sq_ptr + p.sq_off.ring_mask);
+  ring.sq_array = (unsigned *)(ring.sq_ptr + p.sq_off.array);
+  ring.cq_head = (unsigned *)(ring.cq_ptr + p.cq_off.head);
+  ring.cq_tail = (unsigned *)(ring.cq_ptr + p.cq_off.tail);
+  ring.cq_mask = (unsigned *)(ring.cq_ptr + p.cq_off.ring_mask);
+  ring.cqes = (struct io_uring_cqe *)(ring.cq_ptr + p.cq_off.cqes);
+  ring.to_submit = 0;
+
+  return 1;
+}
+
+/**
+ *  \brief Release the ring.
+ */
+
+static void ring_teardown(void) {
+  munmap(ring.sqes, ring.sqes_size);
+  if (ring.cq_size > 0)
+    munmap(ring.cq_ptr, ring.cq_size);
+  munmap(ring.sq_ptr, ring.sq_size);
+  close(ring.fd);
+}
+
+/**
+ *  \brief Queue an operation in the submission ring.
+ *
+ *  \param opcode IORING_OP_OPENAT or IORING_OP_READ.
+ *  \param fd descriptor, AT_FDCWD for an open.
+ *  \param addr file name or buffer.
+ *  \param len length of the read.
+ *  \param off offset of the read.
+ *  \param op index of the operation.
+ */
+
+static void ring_queue(int opcode, int fd, const void *addr, unsigned len, size_t off, int op) {
+  unsigned tail = *ring.sq_tail;
+  unsigned idx = tail & *ring.sq_mask;
+  struct io_uring_sqe *sqe = &ring.sqes[idx];
+
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode = opcode;
+  sqe->fd = fd;
+  sqe->addr = (uint64_t)(uintptr_t)addr;
+  sqe->len = len;
+  sqe->off = off;
+  if (opcode == IORING_OP_OPENAT)
+    sqe->open_flags = O_RDONLY;
+  sqe->user_data = op;
+
+  ring.sq_array[idx] = idx;
+  __atomic_store_n(ring.sq_tail, tail + 1, __ATOMIC_RELEASE);                /* visible to the kernel */
+  ring.to_submit++;
+}
+
+/**
+ *  \brief Function of the thread of the io_uring engine.
+ *
+ *  Its role is to keep the ring full: files are claimed while there are free operations, their reads are
+ *  queued once they are open and a file is handed over when its last read completes. It only waits for room
+ *  in the window when nothing is in flight, as the files in flight can only be released once finished.
+ *
+ *  \param par unused
+ */
+
+static void *uring_loader(void *par) {
+  RingSlot slots[IO_QUEUE_DEPTH];
+  RingOp ops[IO_QUEUE_DEPTH];
+  int free_ops[IO_QUEUE_DEPTH];
+  int num_free_ops = IO_QUEUE_DEPTH;
+  int files_active = 0;
+  int no_more_files = 0;
+  struct timespec begin, finish;
+  long ns;
+
+  for (int s = 0; s < IO_QUEUE_DEPTH; s++) {
+    slots[s].file = -1;
+    free_ops[s] = s;
+  }
+
+  for (;;) {
+
+    /* claim files while there are free operations */
+    while (!no_more_files && num_free_ops > 0 && files_active < IO_QUEUE_DEPTH) {
+      int i = claim_next(files_active == 0);
+      int s = 0, op;
+
+      if (i == -1)
+        no_more_files = 1;
+      if (i < 0)
+        break;
+
+      while (slots[s].file != -1)
+        s++;
+      slots[s].file = i;
+      slots[s].fd = -1;
+      slots[s].map.size = io_files[i].size;
+      slots[s].map.mapped = 0;
+      slots[s].map.data = (io_files[i].size > 0) ? malloc(io_files[i].size) : NULL;
+      slots[s].next_off = 0;
+      slots[s].eof_at = io_files[i].size;
+      slots[s].failed = (io_files[i].size > 0 && slots[s].map.data == NULL);
+      slots[s].pending = 0;
+      files_active++;
+
+      if (!slots[s].failed) {
+        op = free_ops[--num_free_ops];
+        ops[op].kind = OP_OPEN;
+        ops[op].slot = s;
+        ring_queue(IORING_OP_OPENAT, AT_FDCWD, filenames[i], 0, 0, op);
+        slots[s].pending++;
+      }
+    }
+
+    /* queue the reads of the open files */
+    for (int s = 0; s < IO_QUEUE_DEPTH && num_free_ops > 0; s++) {
+      RingSlot *sl = &slots[s];
+
+      while (sl->file != -1 && sl->fd >= 0 && !sl->failed && sl->next_off < sl->eof_at && num_free_ops > 0) {
+        int op = free_ops[--num_free_ops];
+        size_t left = sl->eof_at - sl->next_off;
+
+        ops[op].kind = OP_READ;
+        ops[op].slot = s;
+        ops[op].off = sl->next_off;
+        ops[op].len = (left < IO_READ_SIZE) ? left : IO_READ_SIZE;
+        ring_queue(IORING_OP_READ, sl->fd, sl->map.data + ops[op].off, ops[op].len, ops[op].off, op);
+        sl->next_off += ops[op].len;
+        sl->pending++;
+      }
+    }
+
+    /* hand over the files with nothing left in flight */
+    for (int s = 0; s < IO_QUEUE_DEPTH; s++) {
+      RingSlot *sl = &slots[s];
+
+      if (sl->file == -1 || sl->pending > 0 || (!sl->failed && (sl->fd < 0 || sl->next_off < sl->eof_at)))
+        continue;
+
+      if (sl->fd >= 0)
+        close(sl->fd);
+      sl->map.size = sl->eof_at;
+      if (sl->failed)
+        free(sl->map.data);
+      publish_file(sl->file, !sl->failed, &sl->map, 0);
+      sl->file = -1;
+      files_active--;
+    }
+
+    if (files_active == 0) {
+      if (no_more_files)
+        break;
+      continue;
+    }
+
+    pthread_mutex_lock(&io_access);
+    sample_depth(IO_QUEUE_DEPTH - num_free_ops);
+    pthread_mutex_unlock(&io_access);
+
+    /* submit what was queued and wait for a completion */
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    int n = (int)syscall(__NR_io_uring_enter, ring.fd, ring.to_submit, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+    clock_gettime(CLOCK_MONOTONIC, &finish);
+    ns = elapsed_ns(&begin, &finish);
+
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      perror("error on io_uring_enter");
+      exit(EXIT_FAILURE);
+    }
+    ring.to_submit -= n;
+
+    pthread_mutex_lock(&io_access);
+    engine_ns += ns;
+    pthread_mutex_unlock(&io_access);
+
+    /* reap the completions */
+    unsigned head = *ring.cq_head;
+    while (head != __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE)) {
+      struct io_uring_cqe *cqe = &ring.cqes[head & *ring.cq_mask];
+      RingOp *op = &ops[cqe->user_data];
+      RingSlot *sl = &slots[op->slot];
+      int res = cqe->res;
+
+      sl->pending--;
+      free_ops[num_free_ops++] = (int)cqe->user_data;
+
+      if (op->kind == OP_OPEN) {
+        if (res < 0)
+          sl->failed = 1;
+        else
+          sl->fd = res;
+      }
+      else if (res < 0)
+        sl->failed = 1;
+      else if (res == 0) {                                                       /* file shrank since it was listed */
+        if (op->off < sl->eof_at)
+          sl->eof_at = op->off;
+      }
+      else if ((unsigned)res < op->len) {                                          /* short read, queue the rest */
+        int rest = free_ops[--num_free_ops];
+
+        ops[rest].kind = OP_READ;
+        ops[rest].slot = op->slot;
+        ops[rest].off = op->off + res;
+        ops[rest].len = op->len - res;
+        ring_queue(IORING_OP_READ, sl->fd, sl->map.data + ops[rest].off, ops[rest].len, ops[rest].off, rest);
+        sl->pending++;
+      }
+
+      head++;
+    }
+    __atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+  }
+
+  return NULL;
+}
+
+#endif /* HAVE_IO_URING */
+
+/**
+ *  \brief Start the input engine.
+ *
+ *  Operation carried out by the main thread, before the workers are created. The sizes of the files are
+ *  read here to choose which files the engine loads.
+ *
+ *  \param engine IO_NONE, IO_PREAD or IO_URING.
+ *  \return 1 for Success and 0 for Failure.
+ */
+
+int init_io_engine(int engine) {
+  struct stat st;
+  void *(*loader)(void *) = pread_loader;
+
+  if (engine == IO_NONE)
+    return 1;
+
+  if (engine == IO_URING) {
+#ifdef HAVE_IO_URING
+    if (ring_setup(IO_QUEUE_DEPTH))
+      loader = uring_loader;
+    else
+#endif
+    {
+      fprintf(stderr, "warning: io_uring is not available, the pread engine is used\n");
+      engine = IO_PREAD;
+    }
+  }
+
+  num_io_files = num_files;
+  io_files = calloc(num_io_files, sizeof(IoFile));
+  for (int i = 0; i < num_io_files; i++) {
+    if (stat(filenames[i], &st) == 0 && S_ISREG(st.st_mode) && st.st_size <= IO_PREFETCH_MAX) {
+      io_files[i].size = st.st_size;
+      io_files[i].state = FILE_IDLE;
+    }
+    else
+      io_files[i].state = FILE_OWN;                                         /* the worker opens it, as usual */
+  }
+
+  pthread_cond_init(&file_ready, NULL);
+  pthread_cond_init(&window_free, NULL);
+
+  engine_kind = engine;
+  num_io_threads = (engine == IO_URING) ? 1 : IO_THREADS;
+  io_threads = malloc(num_io_threads * sizeof(pthread_t));
+
+  for (int t = 0; t < num_io_threads; t++)
+    if (pthread_create(&io_threads[t], NULL, loader, NULL) != 0) {
+      perror("error on creating thread of the input engine");
+      return 0;
+    }
+
+  return 1;
+}
+
+/**
+ *  \brief Make the contents of a file available in memory.
+ *
+ *  Operation carried out by the workers, in place of map_file. A file loaded by the engine is handed over,
+ *  a file being loaded is waited for and any other file is opened by the worker.
+ *
+ *  \param file_index index of the file.
+ *  \param mf where the contents are stored.
+ *  \return 1 for Success and 0 for Failure.
+ */
+
+int io_open_file(int file_index, MappedFile *mf) {
+  struct timespec begin, finish;
+  IoFile *f;
+
+  if (io_files == NULL)
+    return map_file(filenames[file_index], mf);
+
+  f = &io_files[file_index];
+
+  pthread_mutex_lock(&io_access);
+
+  if (f->state == FILE_IDLE)                                                  /* the engine is behind */
+    f->state = FILE_OWN;
+
+  if (f->state == FILE_LOADING) {
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    while (f->state == FILE_LOADING)
+      pthread_cond_wait(&file_ready, &io_access);
+    clock_gettime(CLOCK_MONOTONIC, &finish);
+    worker_ns += elapsed_ns(&begin, &finish);
+    worker_waits++;
+  }
+
+  if (f->state == FILE_READY) {
+    *mf = f->map;
+    f->state = FILE_TAKEN;
+    pthread_mutex_unlock(&io_access);
+    return 1;
+  }
+
+  pthread_mutex_unlock(&io_access);
+
+  return map_file(filenames[file_index], mf);
+}
+
+/**
+ *  \brief Release the contents of a file.
+ *
+ *  Operation carried out by the workers, in place of unmap_file. The bytes of a file loaded by the engine
+ *  leave the window.
+ *
+ *  \param file_index index of the file.
+ *  \param mf contents returned by io_open_file.
+ */
+
+void io_close_file(int file_index, MappedFile *mf) {
+  unmap_file(mf);
+
+  if (io_files == NULL)
+    return;
+
+  pthread_mutex_lock(&io_access);
+  if (io_files[file_index].state == FILE_TAKEN) {
+    io_files[file_index].state = FILE_DONE;
+    window_bytes -= io_files[file_index].size;
+    pthread_cond_broadcast(&window_free);
+  }
+  pthread_mutex_unlock(&io_access);
+}
+
+/**
+ *  \brief Print the queue depth and the I/O wait of the input engine.
+ *
+ *  Operation carried out by the main thread, after the workers have terminated.
+ */
+
+void print_io_stats(void) {
+  if (io_files == NULL)
+    return;
+
+  printf("Input engine: %s\n", (engine_kind == IO_URING) ? "io_uring" : "pread");
+  printf("files loaded ahead = %ld (%ld bytes), opened by the workers = %ld\n",
+         files_loaded, bytes_loaded, num_io_files - files_loaded);
+  printf("queue depth: peak = %ld, average = %.1f\n",
+         depth_peak, depth_samples ? (double)depth_sum / depth_samples : 0.0);
+  printf("I/O wait: engine = %.6f s, workers = %.6f s in %ld waits\n",
+         engine_ns / 1000000000.0, worker_ns / 1000000000.0, worker_waits);
+}
+
+/**
+ *  \brief Stop the input engine.
+ *
+ *  Operation carried out by the main thread, after the workers have terminated.
+ */
+
+void free_io_engine(void) {
+  if (io_files == NULL)
+    return;
+
+  pthread_mutex_lock(&io_access);
+  io_stop = 1;
+  pthread_cond_broadcast(&window_free);
+  pthread_mutex_unlock(&io_access);
+
+  for (int t = 0; t < num_io_threads; t++)
+    pthread_join(io_threads[t], NULL);
+
+#ifdef HAVE_IO_URING
+  if (engine_kind == IO_URING)
+    ring_teardown();
+#endif
+
+  for (int i = 0; i < num_io_files; i++)                                    /* loaded but never taken */
+    if (io_files[i].state == FILE_READY)
+      unmap_file(&io_files[i].map);
+
+  pthread_cond_destroy(&file_ready);
+  pthread_cond_destroy(&window_free);
+  free(io_threads);
+  free(io_files);
+  io_files = NULL;
+}
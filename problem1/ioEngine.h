@@ -0,0 +1,48 @@
+/**
+ *  \file ioEngine.h (interface file)
+ *
+ *  \brief Problem name: Total number of words, number of words beginning with a vowel and ending with a consonant.
+ *
+ *  Input engine.
+ *  The files are opened and read ahead of the workers, in file order, either through an io_uring submission
+ *  queue or by a pool of threads issuing pread calls, so that many opens and reads are in flight while the
+ *  workers count the files already loaded.
+ *
+ *  Definition of the operations carried out by the workers:
+ *     \li io_open_file
+ *     \li io_close_file.
+ *
+ *  Definition of the operations carried out by the main thread:
+ *     \li init_io_engine
+ *     \li print_io_stats
+ *     \li free_io_engine.
+ *
+ *  \author Eduardo Santos and Pedro Bastos - April 2022
+ */
+
+#ifndef IOENGINE_H_
+#define IOENGINE_H_
+
+#include "fileReader.h"
+
+/** \brief input engines */
+#define IO_NONE    0
+#define IO_PREAD   1
+#define IO_URING   2
+
+/** \brief Start the input engine. */
+extern int init_io_engine(int engine);
+
+/** \brief Make the contents of a file available in memory. */
+extern int io_open_file(int file_index, MappedFile *mf);
+
+/** \brief Release the contents of a file. */
+extern void io_close_file(int file_index, MappedFile *mf);
+
+/** \brief Print the queue depth and the I/O wait of the input engine. */
+extern void print_io_stats(void);
+
+/** \brief Stop the input engine. */
+extern void free_io_engine(void);
+
+#endif /* IOENGINE_H_ */
@@ -12,6 +12,8 @@
  *  \author Eduardo Santos and Pedro Bastos - April 2022
  */
 
+#define _GNU_SOURCE
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
@@ -23,9 +25,22 @@
 #include <ctype.h>
 #include <time.h>
 #include <libgen.h>
+#include <sched.h>
 
 #include "probConst.h"
 #include "shared.h"
+#include "chunks.h"
+#include "scheduler.h"
+#include "stream.h"
+#include "ioEngine.h"
+#include "resultCache.h"
+#include "resumeState.h"
+#include "textStats.h"
+#include "wordFreq.h"
+#include "service.h"
+#include "dirInput.h"
+#include "inputSource.h"
+#include "sampling.h"
 
 /** \brief time limits */
 struct timespec start, finish;
@@ -37,28 +52,90 @@ int num_files;
 char **filenames;
 
 /** \brief array to save the total number of words for each file */
-int *array_num_words;
+long *array_num_words;
 
 /** \brief array to save the number of words beginning with a vowel for each file */
-int *array_num_vowels;
+long *array_num_vowels;
 
 /** \brief array to save the number of words ending with a consonant for each file */
-int *array_num_cons;
+long *array_num_cons;
+
+/** \brief array to save the number of bytes read from each file */
+long *array_num_bytes;
+
+/** \brief array to save the number of words counted from the bytes read from each file in this run */
+long *array_run_words;
+
+/** \brief array to flag the files that could not be read to their end, whose counts are partial */
+int *array_incomplete;
+
+/** \brief array to save the extended statistics of each file, NULL when they are off */
+TextStats *array_text_stats = NULL;
+
+/** \brief number of most frequent words reported, 0 when they are off */
+int top_words = 0;
+
+/** \brief upper bound of the simulated work after each getVal, in microseconds (0 in benchmark mode) */
+static int max_delay = 40;
+
+/** \brief number of workers */
+unsigned int num_workers;
 
 /** \brief worker threads return status array */
-int statusCons[N];
+int *statusCons;
+
+/** \brief array to flag the workers that met a file they could not open */
+int *worker_failed;
+
+/** \brief thread pinning policies */
+#define PIN_NONE      0
+#define PIN_COMPACT   1
+#define PIN_SCATTER   2
 
 /** \brief worker life cycle routine */
 static void *worker(void *id);
 
+/** \brief worker life cycle routine in the lock-free chunk mode */
+static void *chunk_worker(void *id);
+
+/** \brief worker life cycle routine in the sampling mode */
+static void *sample_worker(void *id);
+
+/** \brief worker life cycle routine in the streaming mode */
+static void *stream_worker(void *id);
+
+/** \brief worker life cycle routine in the service mode */
+static void *service_worker(void *id);
+
+/** \brief reader life cycle routine in the streaming mode */
+static void *stream_reader(void *par);
+
+/** \brief Pin a worker to a CPU. */
+static void pin_worker(pthread_attr_t *attr, unsigned int id, int policy);
+
 /** \brief Prints command usage */
 static void printUsage(char *cmdName)
 {
-  fprintf(stderr, "\nSynopsis: %s OPTIONS [filename / positive number]\n"
+  fprintf(stderr, "\nSynopsis: %s OPTIONS [filename / positive number] [filenames]\n"
                   "  OPTIONS:\n"
                   "  -h      --- print this help\n"
                   "  -f      --- filename\n"
-                  "  -n      --- positive number\n",
+                  "  -n      --- number of workers (default: number of online processors)\n"
+                  "  -a      --- pin the workers to CPUs: compact (neighbouring CPUs) or scatter (spread out)\n"
+                  "  -b      --- benchmark mode, no simulated work between reads\n"
+                  "  -i      --- input engine loading the files ahead of the workers: uring or pread\n"
+                  "  -c      --- result cache file, unchanged files are answered from it\n"
+                  "  -H      --- with -c, compare a hash of the contents as well\n"
+                  "  -r      --- resume state file, files that only grew are counted from where the last run ended\n"
+                  "  -x      --- extended statistics: word lengths, letter frequencies and number of lines\n"
+                  "  -t      --- report the given number of most frequent words of each file and of all the files\n"
+                  "  -s      --- resident service on the given Unix socket, the workers count the requests sent to it\n"
+                  "  -e      --- estimate the counts from a random sample of the given fraction of each file, in (0, 1]\n"
+                  "  -w      --- upper bound of the simulated work after each read, in microseconds (default: 40)\n"
+                  "  -p      --- lock-free chunk mode, the workers pull (file, chunk) tasks\n"
+                  "  a filename - reads the standard input as a stream\n"
+                  "  files ending in .gz or .zst are decompressed as they are read, on reader threads\n"
+                  "  a directory stands for every regular file under it, walked recursively in name order\n",
           cmdName);
 }
 
@@ -70,21 +147,38 @@ static void printUsage(char *cmdName)
  */
 int main(int argc, char *argv[]) {
   
-  pthread_t tIdCons[N];                                                       /* workers internal thread id array */
-  unsigned int cons[N];                                            /* workers application defined thread id array */
-  filenames = malloc((argc - 1) * sizeof(char *));                /* Allocate the needed memory for the filenames */
+  pthread_t *tIdCons;                                                         /* workers internal thread id array */
+  pthread_t *tIdReader = NULL;                                               /* readers internal thread id array */
+  pthread_attr_t attr;                                                    /* creation attributes of a worker */
+  unsigned int *cons;                                              /* workers application defined thread id array */
+  unsigned int readers[STREAM_READERS];                           /* readers application defined thread id array */
+  unsigned int num_readers = 0;                                              /* number of readers of the stream */
+  filenames = malloc(argc * sizeof(char *));                      /* Allocate the needed memory for the filenames */
 
   int i;                                                                                     /* counting variable */
   int *status_p;                                                                   /* pointer to execution status */
+  int exit_status = EXIT_SUCCESS;                                  /* failure when a file was not read to its end */
 
   int opt;                                                                                     /* selected option */
   char *fName = "no name";                                     /* file name (initialized to "no name" by default) */
   int value_opt = -1;                                             /* numeric value (initialized to -1 by default) */
+  int chunk_mode = 0;                                                        /* lock-free chunk mode selected */
+  int pin_policy = PIN_NONE;                                                          /* thread pinning policy */
+  int io_engine = IO_NONE;                                                               /* input engine */
+  char *cache_path = NULL;                                                      /* result cache, if any */
+  int cache_hash = 0;                                                           /* compare content hashes */
+  char *resume_path = NULL;                                                   /* resume state file, if any */
+  char *service_path = NULL;                                                  /* service socket, if any */
+  int stream_mode = 0;                                        /* standard input or compressed files given */
+  int text_stats = 0;                                                           /* extended statistics */
+  double sample_fraction = 0.0;                                          /* fraction sampled, 0 to count all */
+  double elapsed;                                                                        /* elapsed time in s */
+  long total_bytes = 0, total_words = 0;                                                 /* totals of all files */
 
 
   /* Handle command line options */
   do {
-    switch ((opt = getopt(argc, argv, "f:n:h"))) {
+    switch ((opt = getopt(argc, argv, "f:n:hpa:bw:i:c:Hr:xt:s:e:"))) {
       case 'f':                                                                                      /* file name */
         if (optarg[0] == '-') {
           fprintf(stderr, "%s: file name is missing\n", basename(argv[0]));
@@ -103,6 +197,85 @@ int main(int argc, char *argv[]) {
         value_opt = (int)atoi(optarg);
         break;
 
+      case 'a':                                                                                 /* pinning policy */
+        if (strcmp(optarg, "compact") == 0)
+          pin_policy = PIN_COMPACT;
+        else if (strcmp(optarg, "scatter") == 0)
+          pin_policy = PIN_SCATTER;
+        else {
+          fprintf(stderr, "%s: unknown pinning policy\n", basename(argv[0]));
+          printUsage(basename(argv[0]));
+          return EXIT_FAILURE;
+        }
+        break;
+
+      case 'b':                                                                                 /* benchmark mode */
+        max_delay = 0;
+        break;
+
+      case 'w':                                                                                 /* simulated work */
+        if (atoi(optarg) < 0) {
+          fprintf(stderr, "%s: negative simulated work\n", basename(argv[0]));
+          printUsage(basename(argv[0]));
+          return EXIT_FAILURE;
+        }
+        max_delay = atoi(optarg);
+        break;
+
+      case 'i':                                                                                   /* input engine */
+        if (strcmp(optarg, "uring") == 0)
+          io_engine = IO_URING;
+        else if (strcmp(optarg, "pread") == 0)
+          io_engine = IO_PREAD;
+        else {
+          fprintf(stderr, "%s: invalid input engine\n", basename(argv[0]));
+          printUsage(basename(argv[0]));
+          return EXIT_FAILURE;
+        }
+        break;
+
+      case 'c':                                                                                   /* result cache */
+        cache_path = optarg;
+        break;
+
+      case 'H':                                                                          /* content hashes */
+        cache_hash = 1;
+        break;
+
+      case 'r':                                                                           /* incremental counting */
+        resume_path = optarg;
+        break;
+
+      case 'x':                                                                            /* extended statistics */
+        text_stats = 1;
+        break;
+
+      case 't':                                                                          /* most frequent words */
+        if (atoi(optarg) <= 0) {
+          fprintf(stderr, "%s: non positive number of words\n", basename(argv[0]));
+          printUsage(basename(argv[0]));
+          return EXIT_FAILURE;
+        }
+        top_words = atoi(optarg);
+        break;
+
+      case 's':                                                                               /* service mode */
+        service_path = optarg;
+        break;
+
+      case 'e':                                                                              /* sampling mode */
+        sample_fraction = atof(optarg);
+        if (sample_fraction <= 0.0 || sample_fraction > 1.0) {
+          fprintf(stderr, "%s: the sampled fraction must be in (0, 1]\n", basename(argv[0]));
+          printUsage(basename(argv[0]));
+          return EXIT_FAILURE;
+        }
+        break;
+
+      case 'p':                                                                                     /* chunk mode */
+        chunk_mode = 1;
+        break;
+
       case 'h':                                                                                      /* help mode */
         printUsage(basename(argv[0]));
         return EXIT_SUCCESS;
@@ -126,34 +299,156 @@ int main(int argc, char *argv[]) {
   }
 
 
-  /* Save filenames */
-  for (int i = 2; i < argc; i++){
-    filenames[i - 2] = argv[i];
-  }
+  /* Save filenames, the one given with -f followed by the remaining arguments */
+  num_files = 0;
+  if (strcmp(fName, "no name") != 0)
+    filenames[num_files++] = fName;
+  for (i = optind; i < argc; i++)
+    filenames[num_files++] = argv[i];
 
-  /* Save number of files */
-  num_files = argc - 2;
+  /* a directory stands for every regular file under it */
+  if (!expand_directories())
+    return EXIT_FAILURE;
 
-  /* allocate the needed space in the arrays to save the results */
-  array_num_words = (int *)malloc(num_files * sizeof(int));
-  array_num_vowels = (int *)malloc(num_files * sizeof(int));
-  array_num_cons = (int *)malloc(num_files * sizeof(int));
+  /* "-" stands for the standard input, which is counted as it is read, as are the compressed files */
+  for (i = 0; i < num_files; i++)
+    if (strcmp(filenames[i], "-") == 0 || is_compressed(filenames[i]))
+      stream_mode = 1;
 
-  for (i = 0; i < N; i++)
+  /* allocate the needed space in the arrays to save the results */
+  array_num_words = (long *)malloc(num_files * sizeof(long));
+  array_num_vowels = (long *)malloc(num_files * sizeof(long));
+  array_num_cons = (long *)malloc(num_files * sizeof(long));
+  array_num_bytes = (long *)calloc(num_files, sizeof(long));
+  array_run_words = (long *)calloc(num_files, sizeof(long));
+  array_incomplete = (int *)calloc(num_files, sizeof(int));
+  if (text_stats)
+    array_text_stats = (TextStats *)calloc(num_files, sizeof(TextStats));
+
+  /* size the worker pool, by default one worker per online processor */
+  num_workers = (value_opt > 0) ? value_opt : (unsigned int)sysconf(_SC_NPROCESSORS_ONLN);
+  if (num_workers < 1)
+    num_workers = 1;
+
+  tIdCons = malloc(num_workers * sizeof(pthread_t));
+  cons = malloc(num_workers * sizeof(unsigned int));
+  statusCons = malloc(num_workers * sizeof(int));
+  worker_failed = calloc(num_workers, sizeof(int));
+
+  for (i = 0; i < num_workers; i++)
     cons[i] = i;
 
+  /* the service keeps the workers waiting for requests until it is stopped by a signal */
+  if (service_path != NULL) {
+    if (num_files > 0) {
+      fprintf(stderr, "%s: the service takes no files\n", basename(argv[0]));
+      printUsage(basename(argv[0]));
+      return EXIT_FAILURE;
+    }
+    if (!init_service(service_path))
+      return EXIT_FAILURE;
+
+    for (i = 0; i < num_workers; i++) {
+      pin_worker(&attr, i, pin_policy);
+      if (pthread_create(&tIdCons[i], &attr, service_worker, &cons[i]) != 0) {                /* thread worker */
+        perror("error on creating thread worker");
+        exit(EXIT_FAILURE);
+      }
+      pthread_attr_destroy(&attr);
+    }
+
+    serve_requests();
+
+    for (i = 0; i < num_workers; i++) {
+      if (pthread_join(tIdCons[i], (void *)&status_p) != 0) {                                    /* thread worker */
+        perror("error on waiting for thread customer");
+        exit(EXIT_FAILURE);
+      }
+      printf("thread worker, with id %u, has terminated: its status was %d\n", i, *status_p);
+    }
+
+    print_service_stats();
+    free_service();
+    exit(EXIT_SUCCESS);
+  }
+
+  /* the cache and the resume state are kept for regular files, a stream is always counted in full */
+  if (stream_mode && (cache_path != NULL || resume_path != NULL)) {
+    fprintf(stderr, "%s: -c and -r are not combined with compressed files or the standard input\n",
+            basename(argv[0]));
+    printUsage(basename(argv[0]));
+    return EXIT_FAILURE;
+  }
+
+  /* a sample is only drawn from regular files, and only the three counts are estimated */
+  if (sample_fraction > 0.0 && (stream_mode || cache_path != NULL || resume_path != NULL || text_stats ||
+                                top_words > 0 || io_engine != IO_NONE)) {
+    fprintf(stderr, "%s: -e is not combined with -c, -r, -x, -t, -i, compressed files or the standard input\n",
+            basename(argv[0]));
+    printUsage(basename(argv[0]));
+    return EXIT_FAILURE;
+  }
+  if (sample_fraction > 0.0)
+    chunk_mode = 0;
+
+  if (stream_mode)
+    chunk_mode = 0;
+
+  /* unchanged files are answered from the cache, the workers only see the others */
+  if (cache_path != NULL) {
+    if (!init_cache(cache_path, cache_hash))
+      return EXIT_FAILURE;
+    lookup_cached_files();
+  }
+
+  /* files that only grew since the last run are counted from where it ended */
+  if (resume_path != NULL) {
+    if (!init_resume(resume_path))
+      return EXIT_FAILURE;
+    lookup_resume_points();
+  }
+
+  if (chunk_mode && !init_chunks())                                      /* check the files before starting */
+    return EXIT_FAILURE;
+  if (sample_fraction > 0.0 && !init_sampling(sample_fraction))
+    return EXIT_FAILURE;
+  /* each reader reads, and decompresses, a file at a time */
+  if (stream_mode) {
+    num_readers = (num_files < STREAM_READERS) ? (unsigned int)num_files : STREAM_READERS;
+    tIdReader = malloc(num_readers * sizeof(pthread_t));
+    if (!init_stream(num_readers))
+      return EXIT_FAILURE;
+  }
+  if (!stream_mode && !init_io_engine(io_engine))
+    return EXIT_FAILURE;
+  if (top_words > 0 && !init_word_freq())
+    return EXIT_FAILURE;
+
   srandom((unsigned int)getpid());
   clock_gettime (CLOCK_MONOTONIC_RAW, &start);                                            /* begin of measurement */
 
+  /* generation of the reader threads */
+  for (i = 0; i < (int)num_readers; i++) {
+    readers[i] = i;
+    if (pthread_create(&tIdReader[i], NULL, stream_reader, &readers[i]) != 0) {                  /* thread reader */
+      perror("error on creating thread reader");
+      exit(EXIT_FAILURE);
+    }
+  }
+
   /* generation of worker threads */
-  for (i = 0; i < N; i++)
-    if (pthread_create(&tIdCons[i], NULL, worker, &cons[i]) != 0){                             /* thread worker */
+  for (i = 0; i < num_workers; i++) {
+    pin_worker(&attr, i, pin_policy);
+    if (pthread_create(&tIdCons[i], &attr, stream_mode ? stream_worker : chunk_mode ? chunk_worker :
+                       (sample_fraction > 0.0) ? sample_worker : worker, &cons[i]) != 0){         /* thread worker */
       perror("error on creating thread worker");
       exit(EXIT_FAILURE);
     }
+    pthread_attr_destroy(&attr);
+  }
 
   /* waiting for the termination of the worker threads */
-  for (i = 0; i < N; i++) {
+  for (i = 0; i < num_workers; i++) {
     if (pthread_join(tIdCons[i], (void *)&status_p) != 0) {                                      /* thread worker */
       perror("error on waiting for thread customer");
       exit(EXIT_FAILURE);
@@ -161,19 +456,81 @@ int main(int argc, char *argv[]) {
 
     printf("thread worker, with id %u, has terminated: ", i);
     printf("its status was %d\n", *status_p);
+    if (*status_p != EXIT_SUCCESS)
+      exit_status = EXIT_FAILURE;
+  }
+
+  /* waiting for the termination of the reader threads */
+  for (i = 0; i < (int)num_readers; i++) {
+    if (pthread_join(tIdReader[i], (void *)&status_p) != 0) {                                    /* thread reader */
+      perror("error on waiting for thread reader");
+      exit(EXIT_FAILURE);
+    }
+
+    printf("thread reader, with id %d, has terminated: its status was %d\n", i, *status_p);
+    if (*status_p != EXIT_SUCCESS)
+      exit_status = EXIT_FAILURE;
   }
 
   printf ("\nFinal report\n\n");
 
+  /* the sampled blocks give estimates of the counts of each file */
+  if (sample_fraction > 0.0)
+    save_sample_results();
+
+  /* rank the words while the files are still in the order the workers saw them */
+  rank_words();
+
+  /* save where each file ended, then put the cached files back in the list and save the results of the others */
+  store_resume_points();
+  store_cached_files();
+
   clock_gettime (CLOCK_MONOTONIC_RAW, &finish);                                             /* end of measurement */
 
   /* call function to print final results */
   print_final_results();
 
-  /* print time spent */
-  printf ("\nElapsed time = %.6f s\n",  (finish.tv_sec - start.tv_sec) / 1.0 + (finish.tv_nsec - start.tv_nsec) / 1000000000.0);
+  /* print the word lengths, letter frequencies and lines of all the files, when asked with -x */
+  print_text_stats();
+
+  /* print the most frequent words of each file and of all the files, when asked with -t */
+  print_top_words();
+  free_word_freq();
+
+  /* print the confidence intervals of the estimates, when asked with -e */
+  if (sample_fraction > 0.0)
+    print_sample_stats();
 
-  exit(EXIT_SUCCESS);
+  /* print the lock and condition waits of the workers, when compiled with -DMONITOR_STATS */
+  if (!chunk_mode && !stream_mode && sample_fraction == 0.0)
+    print_monitor_stats();
+
+  /* print how the chunks were balanced among the workers */
+  if (chunk_mode) {
+    print_scheduler_stats();
+    free_chunks();
+  }
+  if (sample_fraction > 0.0) {
+    print_scheduler_stats();
+    free_sampling();
+  }
+  if (stream_mode)
+    free_stream();
+
+  /* print how far ahead of the workers the files were loaded */
+  print_io_stats();
+  free_io_engine();
+
+  /* print time spent and throughput */
+  elapsed = (finish.tv_sec - start.tv_sec) / 1.0 + (finish.tv_nsec - start.tv_nsec) / 1000000000.0;
+  for (i = 0; i < num_files; i++) {
+    total_bytes += array_num_bytes[i];
+    total_words += array_run_words[i];                          /* over the same bytes, not cache hits */
+  }
+  printf ("\nElapsed time = %.6f s\n", elapsed);
+  printf ("Throughput = %.3f MB/s, %.0f words/s\n", total_bytes / elapsed / 1000000.0, total_words / elapsed);
+
+  exit(exit_status);
 }
 
 /**
@@ -194,7 +551,8 @@ static void *worker(void *par){
 
     /* while there is data to read from the current file */
     while (getVal(id)){
-      usleep((unsigned int)floor(40.0 * random() / RAND_MAX + 1.5));
+      if (max_delay > 0)                                                                    /* simulated work */
+        usleep((unsigned int)floor(max_delay * (double)random() / RAND_MAX + 1.5));
     }
     
     /* saves results for each file in the variables */
@@ -204,6 +562,180 @@ static void *worker(void *par){
     check_close_file(id);
   }
 
+  /* move the words collected to the global table */
+  if (top_words > 0)
+    flush_words(id);
+
+  statusCons[id] = worker_failed[id] ? EXIT_FAILURE : EXIT_SUCCESS;
+  pthread_exit(&statusCons[id]);
+}
+
+/**
+ *  \brief Function worker in the lock-free chunk mode.
+ *
+ *  Its role is to count chunks of the files until there are no more, without waiting for the other workers.
+ *
+ *  \param par pointer to application defined worker identification
+ */
+
+static void *chunk_worker(void *par){
+
+  /* worker id */
+  unsigned int id = *((unsigned int *)par);
+
+  /* task index */
+  int t;
+
+  /* while there are chunks to count */
+  while ((t = get_chunk_task(id)) != -1)
+    count_chunk_task(id, t);
+
+  /* move the words collected to the global table */
+  if (top_words > 0)
+    flush_words(id);
+
+  statusCons[id] = worker_failed[id] ? EXIT_FAILURE : EXIT_SUCCESS;
+  pthread_exit(&statusCons[id]);
+}
+
+/**
+ *  \brief Function worker in the sampling mode.
+ *
+ *  Its role is to count the sampled blocks of the files until there are no more.
+ *
+ *  \param par pointer to application defined worker identification
+ */
+
+static void *sample_worker(void *par){
+
+  /* worker id */
+  unsigned int id = *((unsigned int *)par);
+
+  /* task index */
+  int t;
+
+  /* while there are blocks to count */
+  while ((t = get_sample_task(id)) != -1)
+    count_sample_task(id, t);
+
+  statusCons[id] = EXIT_SUCCESS;
+  pthread_exit(&statusCons[id]);
+}
+
+/**
+ *  \brief Function worker in the streaming mode.
+ *
+ *  Its role is to count the buffers filled by the reader until the stream is over.
+ *
+ *  \param par pointer to application defined worker identification
+ */
+
+static void *stream_worker(void *par){
+
+  /* worker id */
+  unsigned int id = *((unsigned int *)par);
+
+  /* number of the buffer in the stream */
+  long seq;
+
+  /* while there are buffers to count */
+  while ((seq = get_stream_buffer(id)) != -1)
+    count_stream_buffer(id, seq);
+
+  /* move the words collected to the global table */
+  if (top_words > 0)
+    flush_words(id);
+
+  statusCons[id] = EXIT_SUCCESS;
+  pthread_exit(&statusCons[id]);
+}
+
+/**
+ *  \brief Function worker in the service mode.
+ *
+ *  Its role is to count the jobs of the requests sent to the service until it is stopped.
+ *
+ *  \param par pointer to application defined worker identification
+ */
+
+static void *service_worker(void *par){
+
+  /* worker id */
+  unsigned int id = *((unsigned int *)par);
+
+  /* next job */
+  ServiceJob job;
+
+  /* while the service is running */
+  while (get_service_job(id, &job))
+    run_service_job(id, &job);
+
   statusCons[id] = EXIT_SUCCESS;
   pthread_exit(&statusCons[id]);
 }
+
+/**
+ *  \brief Function reader in the streaming mode.
+ *
+ *  Its role is to fill the buffers of the ring from the files, decompressing them, until every file was read.
+ *
+ *  \param par pointer to application defined reader identification
+ */
+
+static void *stream_reader(void *par){
+
+  /* reader id */
+  unsigned int id = *((unsigned int *)par);
+
+  /* readers return status */
+  static int status[STREAM_READERS];
+
+  /* outcome of reading a file */
+  int result;
+
+  /* while there are files left to read, a file that could not be read to its end failing the reader */
+  status[id] = EXIT_SUCCESS;
+  while ((result = read_stream_file(id)) != 0)
+    if (result < 0)
+      status[id] = EXIT_FAILURE;
+
+  pthread_exit(&status[id]);
+}
+
+/**
+ *  \brief Pin a worker to a CPU.
+ *
+ *  The CPUs are the ones the process may run on. Compact puts worker i on the i-th of them, so that workers
+ *  share caches; scatter spaces the workers evenly over all of them. With more workers than CPUs both wrap
+ *  around. The CPU is set on the attributes the worker is created with, so that it starts on it and its
+ *  per-worker state is first touched there.
+ *
+ *  \param attr attributes of the worker, initialized here and destroyed by the caller after its creation.
+ *  \param id worker identification.
+ *  \param policy PIN_NONE, PIN_COMPACT or PIN_SCATTER.
+ */
+
+static void pin_worker(pthread_attr_t *attr, unsigned int id, int policy) {
+  cpu_set_t allowed, target;
+  int cpus[CPU_SETSIZE];
+  int num_cpus = 0;
+  int index;
+
+  pthread_attr_init(attr);
+  if (policy == PIN_NONE || sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+    return;
+
+  for (int c = 0; c < CPU_SETSIZE; c++)
+    if (CPU_ISSET(c, &allowed))
+      cpus[num_cpus++] = c;
+
+  if (policy == PIN_SCATTER && num_workers < num_cpus)
+    index = (int)((long)id * num_cpus / num_workers);
+  else
+    index = id % num_cpus;
+
+  CPU_ZERO(&target);
+  CPU_SET(cpus[index], &target);
+  if (pthread_attr_setaffinity_np(attr, sizeof(target), &target) != 0)
+    fprintf(stderr, "warning: worker %u could not be pinned to CPU %d\n", id, cpus[index]);
+}
@@ -13,7 +13,73 @@
 
 /* Generic parameters */
 
-/** \brief number of workers */
-#define  N           8
+/** \brief nominal size of a chunk in the chunk mode, in bytes */
+#define  CHUNK_SIZE  (1 << 20)
+
+/** \brief size of a buffer of the ring in the streaming mode, in bytes */
+#define  STREAM_BUFFER_SIZE  (4 << 20)
+
+/** \brief number of buffers of the ring in the streaming mode, per worker */
+#define  STREAM_BUFFERS_PER_WORKER  2
+
+/** \brief most reader threads of the streaming mode, each reading and decompressing a file at a time */
+#define  STREAM_READERS  4
+
+/** \brief size of the reads of a compressed file in the streaming mode, in bytes */
+#define  DECODE_READ_SIZE  (1 << 18)
+
+/** \brief number of chars decoded at a time by the scalar counting paths */
+#define  DECODE_BATCH  16
+
+/** \brief number of reads in flight of the input engine */
+#define  IO_QUEUE_DEPTH  32
+
+/** \brief size of each read of the input engine, in bytes */
+#define  IO_READ_SIZE  (1 << 20)
+
+/** \brief bytes the input engine may hold loaded ahead of the workers */
+#define  IO_WINDOW  (256 << 20)
+
+/** \brief largest file loaded by the input engine, bigger ones are mapped by the workers */
+#define  IO_PREFETCH_MAX  (64 << 20)
+
+/** \brief number of threads of the pread input engine */
+#define  IO_THREADS  4
+
+/** \brief target size of a batch of small files in the chunk mode, files of a single chunk are batched */
+#define  BATCH_SIZE  (1 << 20)
+
+/** \brief most files of a batch */
+#define  BATCH_MAX_FILES  256
+
+/** \brief size of a block of the sampling mode, in bytes */
+#define  SAMPLE_BLOCK  (64 << 10)
+
+/** \brief least number of blocks sampled from a file, so that its variance can be estimated */
+#define  SAMPLE_MIN_BLOCKS  16
+
+/** \brief bytes before a sampled block decoded to know whether it starts inside a word */
+#define  SAMPLE_LOOKBACK  64
+
+/** \brief longest word kept by the word frequency mode, in bytes, longer words are cut */
+#define  WORD_MAX_BYTES  64
+
+/** \brief number of shards of the global word table */
+#define  WORD_SHARDS  64
+
+/** \brief distinct words a worker collects before moving them to the global word table */
+#define  WORD_LOCAL_ENTRIES  (1 << 16)
+
+/** \brief size of a block of the word key arenas, in bytes */
+#define  WORD_ARENA_BLOCK  (1 << 20)
+
+/** \brief pending connections of the service socket */
+#define  SERVICE_BACKLOG  128
+
+/** \brief most items of a request of the service */
+#define  SERVICE_MAX_ITEMS  4096
+
+/** \brief most bytes of a request of the service, inline data included */
+#define  SERVICE_MAX_REQUEST  (64 << 20)
 
 #endif /* PROBCONST_H_ */
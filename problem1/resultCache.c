@@ -0,0 +1,387 @@
+/**
+ *  \file resultCache.c (implementation file)
+ *
+ *  \brief Problem name: Total number of words, number of words beginning with a vowel and ending with a consonant.
+ *
+ *  Persistent result cache.
+ *  The cache is a text file with one line per regular file ever counted: device, inode, size, modification
+ *  time, hash of the contents (0 when not computed) and the three results. A file is answered from the cache
+ *  when its device and inode are found with the same size and modification time and, if content hashes are
+ *  enabled, the same 64 bit FNV-1a hash of its contents.
+ *
+ *  The files answered from the cache are moved after the others in the list of files, so the workers only see
+ *  the first num_files entries; the list and the results arrays are put back in order after the workers have
+ *  terminated. The cache is then rewritten through a temporary file and a rename, so a run that is
+ *  interrupted never leaves a truncated cache behind.
+ *
+ *  Definition of the operations carried out by the main thread:
+ *     \li init_cache
+ *     \li lookup_cached_files
+ *     \li store_cached_files.
+ *
+ *  \author Eduardo Santos and Pedro Bastos - April 2022
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "fileReader.h"
+#include "textStats.h"
+
+/** \brief array of the filenames retrieved from the main file */
+extern char **filenames;
+
+/** \brief variable to save the number of files */
+extern int num_files;
+
+/** \brief array to save the total number of words for each file */
+extern long *array_num_words;
+
+/** \brief array to save the number of words beginning with a vowel for each file */
+extern long *array_num_vowels;
+
+/** \brief array to save the number of words ending with a consonant for each file */
+extern long *array_num_cons;
+
+/** \brief array to save the number of bytes read from each file */
+extern long *array_num_bytes;
+
+/** \brief array to save the number of words counted from the bytes read from each file in this run */
+extern long *array_run_words;
+
+/** \brief array to flag the files that could not be read to their end, whose counts are partial */
+extern int *array_incomplete;
+
+/** \brief array to save the extended statistics of each file, NULL when they are off */
+extern TextStats *array_text_stats;
+
+/** \brief first line of a cache file */
+#define CACHE_HEADER   "# wordCount result cache 1"
+
+/** \brief results of a file and the identity they belong to */
+typedef struct {
+  unsigned long long dev;                                                                         /* device */
+  unsigned long long ino;                                                                          /* inode */
+  long long size;                                                                        /* size in bytes */
+  long long mtime_sec;                                                        /* modification time, seconds */
+  long long mtime_nsec;                                                   /* modification time, nanoseconds */
+  unsigned long long hash;                                                  /* hash of the contents, or 0 */
+  long words;                                                                   /* total number of words */
+  long vowels;                                                         /* words beginning with a vowel */
+  long cons;                                                          /* words ending with a consonant */
+} CacheEntry;
+
+/** \brief path of the cache file, NULL when the cache is off */
+static const char *cache_path = NULL;
+
+/** \brief flag that indicates content hashes are compared */
+static int cache_hash;
+
+/** \brief entries of the cache, sorted by device and inode */
+static CacheEntry *entries;
+
+/** \brief number of entries */
+static long num_entries;
+
+/** \brief number of files before the lookup */
+static int all_files;
+
+/** \brief original index of the file at each position of the list */
+static int *order;
+
+/** \brief identity of each file before it was counted, by original index */
+static struct stat *file_stats;
+
+/** \brief state of each file, by original index: 0 not cacheable, 1 to count, 2 answered from the cache */
+static int *file_cache_state;
+
+/**
+ *  \brief Compare two entries by device and inode.
+ */
+
+static int compare_entries(const void *a, const void *b) {
+  const CacheEntry *x = a, *y = b;
+
+  if (x->dev != y->dev)
+    return (x->dev < y->dev) ? -1 : 1;
+  if (x->ino != y->ino)
+    return (x->ino < y->ino) ? -1 : 1;
+  return 0;
+}
+
+/**
+ *  \brief Find the entry of a file.
+ *
+ *  \param st identity of the file.
+ *  \return entry, or NULL if the file is not in the cache.
+ */
+
+static CacheEntry *find_entry(const struct stat *st) {
+  CacheEntry key;
+
+  key.dev = st->st_dev;
+  key.ino = st->st_ino;
+
+  return bsearch(&key, entries, num_entries, sizeof(CacheEntry), compare_entries);
+}
+
+/**
+ *  \brief 64 bit FNV-1a hash of the contents of a file.
+ *
+ *  \param name file name.
+ *  \return hash, never 0, or 0 if the file cannot be read.
+ */
+
+static unsigned long long hash_file(const char *name) {
+  MappedFile mf;
+  uint64_t h = 0xCBF29CE484222325ull;
+
+  if (!map_file(name, &mf))
+    return 0;
+
+  for (size_t i = 0; i < mf.size; i++)
+    h = (h ^ mf.data[i]) * 0x100000001B3ull;
+
+  unmap_file(&mf);
+
+  return h ? h : 1;
+}
+
+/**
+ *  \brief Check whether a file still matches its entry.
+ *
+ *  \param e entry.
+ *  \param st identity of the file.
+ *  \param name file name, to hash.
+ *  \return 1 if the results of the entry can be used.
+ */
+
+static int entry_matches(const CacheEntry *e, const struct stat *st, const char *name) {
+  if (e->size != st->st_size || e->mtime_sec != st->st_mtim.tv_sec || e->mtime_nsec != st->st_mtim.tv_nsec)
+    return 0;
+
+  return !cache_hash || (e->hash != 0 && e->hash == hash_file(name));
+}
+
+/**
+ *  \brief Load the cache.
+ *
+ *  Operation carried out by the main thread. A missing cache file is an empty cache.
+ *
+ *  \param path path of the cache file.
+ *  \param use_hash 1 to compare hashes of the contents as well.
+ *  \return 1 for Success and 0 for Failure.
+ */
+
+int init_cache(const char *path, int use_hash) {
+  char line[256];
+  long cap = 1024;
+  CacheEntry e;
+  FILE *fp;
+
+  cache_path = path;
+  cache_hash = use_hash;
+  num_entries = 0;
+  if ((entries = malloc(cap * sizeof(CacheEntry))) == NULL) {
+    perror("error on allocating the cache");
+    return 0;
+  }
+
+  if ((fp = fopen(path, "r")) == NULL)                                                  /* no cache yet */
+    return 1;
+
+  if (fgets(line, sizeof(line), fp) == NULL || strncmp(line, CACHE_HEADER, strlen(CACHE_HEADER)) != 0) {
+    fprintf(stderr, "Error! %s is not a result cache.\n", path);
+    fclose(fp);
+    return 0;
+  }
+
+  while (fgets(line, sizeof(line), fp) != NULL) {
+    if (sscanf(line, "%llu %llu %lld %lld %lld %llx %ld %ld %ld", &e.dev, &e.ino, &e.size, &e.mtime_sec,
+               &e.mtime_nsec, &e.hash, &e.words, &e.vowels, &e.cons) != 9) {
+      fprintf(stderr, "warning: malformed line in %s ignored\n", path);
+      continue;
+    }
+    if (num_entries == cap && (entries = realloc(entries, (cap *= 2) * sizeof(CacheEntry))) == NULL) {
+      perror("error on allocating the cache");
+      fclose(fp);
+      return 0;
+    }
+    entries[num_entries++] = e;
+  }
+
+  fclose(fp);
+  qsort(entries, num_entries, sizeof(CacheEntry), compare_entries);
+
+  return 1;
+}
+
+/**
+ *  \brief Reorder the list of files and the results arrays.
+ *
+ *  \param to_original 0 to move the file at order[k] to position k, 1 to put it back.
+ */
+
+static void permute_files(int to_original) {
+  char **names = malloc(all_files * sizeof(char *));
+  long *values = malloc(all_files * 6 * sizeof(long));
+  TextStats *stats = (array_text_stats != NULL) ? malloc(all_files * sizeof(TextStats)) : NULL;
+
+  for (int k = 0; k < all_files; k++) {
+    int from = to_original ? k : order[k];
+    int to = to_original ? order[k] : k;
+
+    names[to] = filenames[from];
+    values[6 * to] = array_num_words[from];
+    values[6 * to + 1] = array_num_vowels[from];
+    values[6 * to + 2] = array_num_cons[from];
+    values[6 * to + 3] = array_num_bytes[from];
+    values[6 * to + 4] = array_run_words[from];
+    values[6 * to + 5] = array_incomplete[from];
+    if (stats != NULL)
+      stats[to] = array_text_stats[from];
+  }
+
+  for (int k = 0; k < all_files; k++) {
+    filenames[k] = names[k];
+    array_num_words[k] = values[6 * k];
+    array_num_vowels[k] = values[6 * k + 1];
+    array_num_cons[k] = values[6 * k + 2];
+    array_num_bytes[k] = values[6 * k + 3];
+    array_run_words[k] = values[6 * k + 4];
+    array_incomplete[k] = (int)values[6 * k + 5];
+    if (stats != NULL)
+      array_text_stats[k] = stats[k];
+  }
+
+  free(stats);
+  free(values);
+  free(names);
+}
+
+/**
+ *  \brief Answer the unchanged files from the cache and leave only the others to the workers.
+ *
+ *  Operation carried out by the main thread, before the workers are created. The results of the files found
+ *  in the cache are stored in the results arrays, with no bytes read, and num_files is reduced to the files
+ *  still to count, which are moved to the front of the list.
+ *
+ *  \return number of files answered from the cache.
+ */
+
+int lookup_cached_files(void) {
+  CacheEntry *e;
+  int hits = 0, k = 0;
+
+  if (cache_path == NULL)
+    return 0;
+
+  all_files = num_files;
+  order = malloc(all_files * sizeof(int));
+  file_stats = malloc(all_files * sizeof(struct stat));
+  file_cache_state = calloc(all_files, sizeof(int));
+
+  for (int i = 0; i < all_files; i++) {
+    if (stat(filenames[i], &file_stats[i]) != 0 || !S_ISREG(file_stats[i].st_mode))
+      continue;
+
+    file_cache_state[i] = 1;
+    if ((e = find_entry(&file_stats[i])) != NULL && entry_matches(e, &file_stats[i], filenames[i])) {
+      array_num_words[i] = e->words;
+      array_num_vowels[i] = e->vowels;
+      array_num_cons[i] = e->cons;
+      array_num_bytes[i] = 0;
+      array_run_words[i] = 0;
+      file_cache_state[i] = 2;
+      hits++;
+    }
+  }
+
+  /* files to count first, in their order, then the ones answered from the cache */
+  for (int i = 0; i < all_files; i++)
+    if (file_cache_state[i] != 2)
+      order[k++] = i;
+  for (int i = 0; i < all_files; i++)
+    if (file_cache_state[i] == 2)
+      order[k++] = i;
+
+  permute_files(0);
+  num_files = all_files - hits;
+
+  printf("Result cache: %d of %d files unchanged\n", hits, all_files);
+
+  return hits;
+}
+
+/**
+ *  \brief Restore the list of files and save the results of the counted ones in the cache.
+ *
+ *  Operation carried out by the main thread, after the workers have terminated. A file that changed while
+ *  it was counted, or that could not be read, is not saved.
+ */
+
+void store_cached_files(void) {
+  long old_entries = num_entries;
+  char *tmp_path;
+  struct stat st;
+  CacheEntry *e;
+  FILE *fp;
+
+  if (cache_path == NULL)
+    return;
+
+  permute_files(1);
+  num_files = all_files;
+
+  entries = realloc(entries, (num_entries + all_files) * sizeof(CacheEntry));
+
+  /* a file that could not be read has no counts to keep, it must not be taken for an unchanged one */
+  for (int i = 0; i < all_files; i++) {
+    if (file_cache_state[i] != 1 || array_incomplete[i] || stat(filenames[i], &st) != 0 || st.st_dev != file_stats[i].st_dev
+        || st.st_ino != file_stats[i].st_ino || st.st_size != file_stats[i].st_size
+        || st.st_mtim.tv_sec != file_stats[i].st_mtim.tv_sec || st.st_mtim.tv_nsec != file_stats[i].st_mtim.tv_nsec)
+      continue;
+
+    /* an entry of a file replaced in place is overwritten, a new file gets one */
+    if ((e = bsearch(&(CacheEntry){ .dev = st.st_dev, .ino = st.st_ino }, entries, old_entries, sizeof(CacheEntry),
+                     compare_entries)) == NULL)
+      e = &entries[num_entries++];
+
+    e->dev = st.st_dev;
+    e->ino = st.st_ino;
+    e->size = st.st_size;
+    e->mtime_sec = st.st_mtim.tv_sec;
+    e->mtime_nsec = st.st_mtim.tv_nsec;
+    e->hash = cache_hash ? hash_file(filenames[i]) : 0;
+    e->words = array_num_words[i];
+    e->vowels = array_num_vowels[i];
+    e->cons = array_num_cons[i];
+  }
+
+  tmp_path = malloc(strlen(cache_path) + 5);
+  sprintf(tmp_path, "%s.tmp", cache_path);
+
+  if ((fp = fopen(tmp_path, "w")) == NULL) {
+    perror("error on writing the result cache");
+    free(tmp_path);
+    return;
+  }
+
+  fprintf(fp, "%s\n", CACHE_HEADER);
+  for (long j = 0; j < num_entries; j++)
+    fprintf(fp, "%llu %llu %lld %lld %lld %llx %ld %ld %ld\n", entries[j].dev, entries[j].ino, entries[j].size,
+            entries[j].mtime_sec, entries[j].mtime_nsec, entries[j].hash, entries[j].words, entries[j].vowels,
+            entries[j].cons);
+
+  if (fclose(fp) != 0 || rename(tmp_path, cache_path) != 0)
+    perror("error on writing the result cache");
+
+  free(tmp_path);
+  free(file_cache_state);
+  free(file_stats);
+  free(order);
+  free(entries);
+}
@@ -0,0 +1,31 @@
+/**
+ *  \file resultCache.h (interface file)
+ *
+ *  \brief Problem name: Total number of words, number of words beginning with a vowel and ending with a consonant.
+ *
+ *  Persistent result cache.
+ *  The results of every regular file are kept on disk, keyed by the identity of the file (device, inode, size
+ *  and modification time) and optionally by a hash of its contents. Files found unchanged are answered from
+ *  the cache and only the others are handed to the workers.
+ *
+ *  Definition of the operations carried out by the main thread:
+ *     \li init_cache
+ *     \li lookup_cached_files
+ *     \li store_cached_files.
+ *
+ *  \author Eduardo Santos and Pedro Bastos - April 2022
+ */
+
+#ifndef RESULTCACHE_H_
+#define RESULTCACHE_H_
+
+/** \brief Load the cache. */
+extern int init_cache(const char *path, int use_hash);
+
+/** \brief Answer the unchanged files from the cache and leave only the others to the workers. */
+extern int lookup_cached_files(void);
+
+/** \brief Restore the list of files and save the results of the counted ones in the cache. */
+extern void store_cached_files(void);
+
+#endif /* RESULTCACHE_H_ */
@@ -0,0 +1,344 @@
+/**
+ *  \file resumeState.c (implementation file)
+ *
+ *  \brief Problem name: Total number of words, number of words beginning with a vowel and ending with a consonant.
+ *
+ *  Incremental counting of append-only files.
+ *  The state file has one line per regular file: device, inode, byte offset, hash of the bytes just before the
+ *  offset, the three counts, the previous char and the end of word flag. A file is resumed from its offset
+ *  when its device and inode are found, it is at least that long and the last RESUME_TAIL bytes before the
+ *  offset still hash the same, which tells an appended file from one truncated and rewritten; otherwise it is
+ *  counted from the start. Only those bytes are checked: a change further back in a file that also grew is
+ *  not detected, and the counts of that file are then wrong.
+ *
+ *  The offset saved is the end of the last complete UTF-8 sequence, so that a sequence cut by the end of the
+ *  file is decoded whole once the rest of it is appended. The bytes of a cut sequence are counted on a copy of
+ *  the state, for the results of this run only.
+ *
+ *  Definition of the operations carried out by the workers:
+ *     \li get_resume_point
+ *     \li resume_limit
+ *     \li set_resume_point.
+ *
+ *  Definition of the operations carried out by the main thread:
+ *     \li init_resume
+ *     \li lookup_resume_points
+ *     \li store_resume_points.
+ *
+ *  \author Eduardo Santos and Pedro Bastos - April 2022
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include "wordCount.h"
+#include "utf8.h"
+
+/** \brief array of the filenames retrieved from the main file */
+extern char **filenames;
+
+/** \brief variable to save the number of files */
+extern int num_files;
+
+/** \brief first line of a state file */
+#define RESUME_HEADER   "# wordCount resume state 1"
+
+/** \brief number of bytes before the offset that are hashed */
+#define RESUME_TAIL     64
+
+/** \brief state of a file at an offset */
+typedef struct {
+  unsigned long long dev;                                                                         /* device */
+  unsigned long long ino;                                                                          /* inode */
+  long long offset;                                                              /* bytes counted so far */
+  unsigned long long tail_hash;                                      /* hash of the bytes before the offset */
+  CountState state;                                                            /* counting state at offset */
+} ResumeEntry;
+
+/** \brief where a file of this run starts and where it ended */
+typedef struct {
+  int regular;                                                               /* 1 for a regular file */
+  unsigned long long dev;                                                                         /* device */
+  unsigned long long ino;                                                                          /* inode */
+  size_t start;                                                                       /* offset resumed from */
+  CountState start_state;                                                        /* state resumed from */
+  int recorded;                                                            /* 1 once the file was counted */
+  ResumeEntry end;                                                                   /* state to save */
+} ResumePoint;
+
+/** \brief path of the state file, NULL when incremental counting is off */
+static const char *resume_path = NULL;
+
+/** \brief saved states, sorted by device and inode */
+static ResumeEntry *entries;
+
+/** \brief number of saved states */
+static long num_entries;
+
+/** \brief where each file of this run starts, by file index */
+static ResumePoint *points;
+
+/** \brief number of files of this run */
+static int num_points;
+
+/**
+ *  \brief Compare two entries by device and inode.
+ */
+
+static int compare_entries(const void *a, const void *b) {
+  const ResumeEntry *x = a, *y = b;
+
+  if (x->dev != y->dev)
+    return (x->dev < y->dev) ? -1 : 1;
+  if (x->ino != y->ino)
+    return (x->ino < y->ino) ? -1 : 1;
+  return 0;
+}
+
+/**
+ *  \brief 64 bit FNV-1a hash of the bytes just before an offset.
+ *
+ *  \param data first byte of the file.
+ *  \param offset offset.
+ *  \return hash.
+ */
+
+static unsigned long long tail_hash(const unsigned char *data, size_t offset) {
+  size_t from = (offset > RESUME_TAIL) ? offset - RESUME_TAIL : 0;
+  uint64_t h = 0xCBF29CE484222325ull;
+
+  for (size_t i = from; i < offset; i++)
+    h = (h ^ data[i]) * 0x100000001B3ull;
+
+  return h;
+}
+
+/**
+ *  \brief Load the saved states.
+ *
+ *  Operation carried out by the main thread. A missing state file means every file is counted from the
+ *  start.
+ *
+ *  \param path path of the state file.
+ *  \return 1 for Success and 0 for Failure.
+ */
+
+int init_resume(const char *path) {
+  char line[256];
+  long cap = 1024;
+  ResumeEntry e;
+  FILE *fp;
+
+  resume_path = path;
+  num_entries = 0;
+  if ((entries = malloc(cap * sizeof(ResumeEntry))) == NULL) {
+    perror("error on allocating the saved states");
+    return 0;
+  }
+
+  if ((fp = fopen(path, "r")) == NULL)                                                 /* first run */
+    return 1;
+
+  if (fgets(line, sizeof(line), fp) == NULL || strncmp(line, RESUME_HEADER, strlen(RESUME_HEADER)) != 0) {
+    fprintf(stderr, "Error! %s is not a resume state file.\n", path);
+    fclose(fp);
+    return 0;
+  }
+
+  while (fgets(line, sizeof(line), fp) != NULL) {
+    if (sscanf(line, "%llu %llu %lld %llx %ld %ld %ld %d %d", &e.dev, &e.ino, &e.offset, &e.tail_hash,
+               &e.state.total_num_words, &e.state.num_vowels, &e.state.num_cons, &e.state.value_before,
+               &e.state.end_of_word) != 9) {
+      fprintf(stderr, "warning: malformed line in %s ignored\n", path);
+      continue;
+    }
+    if (num_entries == cap && (entries = realloc(entries, (cap *= 2) * sizeof(ResumeEntry))) == NULL) {
+      perror("error on allocating the saved states");
+      fclose(fp);
+      return 0;
+    }
+    entries[num_entries++] = e;
+  }
+
+  fclose(fp);
+  qsort(entries, num_entries, sizeof(ResumeEntry), compare_entries);
+
+  return 1;
+}
+
+/**
+ *  \brief Check that the bytes before the saved offset of a file did not change.
+ *
+ *  \param name file name.
+ *  \param e saved state.
+ *  \return 1 if the file can be resumed.
+ */
+
+static int tail_unchanged(const char *name, const ResumeEntry *e) {
+  unsigned char tail[RESUME_TAIL];
+  size_t len = (e->offset > RESUME_TAIL) ? RESUME_TAIL : (size_t)e->offset;
+  ssize_t n;
+  int fd;
+
+  if ((fd = open(name, O_RDONLY)) < 0)
+    return 0;
+  n = pread(fd, tail, len, e->offset - len);
+  close(fd);
+
+  return n == (ssize_t)len && tail_hash(tail, len) == e->tail_hash;
+}
+
+/**
+ *  \brief Find where each file is resumed.
+ *
+ *  Operation carried out by the main thread, before the workers are created.
+ */
+
+void lookup_resume_points(void) {
+  int resumed = 0;
+  struct stat st;
+  ResumeEntry key, *e;
+
+  if (resume_path == NULL)
+    return;
+
+  num_points = num_files;
+  points = calloc(num_points, sizeof(ResumePoint));
+
+  for (int i = 0; i < num_points; i++) {
+    init_count_state(&points[i].start_state);
+
+    if (stat(filenames[i], &st) != 0 || !S_ISREG(st.st_mode))
+      continue;
+
+    points[i].regular = 1;
+    points[i].dev = key.dev = st.st_dev;
+    points[i].ino = key.ino = st.st_ino;
+
+    e = bsearch(&key, entries, num_entries, sizeof(ResumeEntry), compare_entries);
+    if (e != NULL && e->offset <= st.st_size && tail_unchanged(filenames[i], e)) {
+      points[i].start = e->offset;
+      points[i].start_state = e->state;
+      resumed++;
+    }
+  }
+
+  printf("Resume state: %d of %d files resumed\n", resumed, num_points);
+}
+
+/**
+ *  \brief Offset and counting state a file is resumed from.
+ *
+ *  Operation carried out by the workers, once the file is open. A file that is now shorter than the offset
+ *  is counted from the start.
+ *
+ *  \param file_index index of the file.
+ *  \param size size of the file now.
+ *  \param state where the counting state is stored.
+ *  \return offset to count from.
+ */
+
+size_t get_resume_point(int file_index, size_t size, CountState *state) {
+  if (resume_path == NULL || points[file_index].start > size) {
+    init_count_state(state);
+    return 0;
+  }
+
+  *state = points[file_index].start_state;
+
+  return points[file_index].start;
+}
+
+/**
+ *  \brief End of the bytes of a file that can be counted and resumed from later.
+ *
+ *  Operation carried out by the workers.
+ *
+ *  \param data first byte of the file.
+ *  \param size size of the file.
+ *  \return size, or the start of a UTF-8 sequence cut by the end of the file when resuming is on.
+ */
+
+size_t resume_limit(const unsigned char *data, size_t size) {
+  return (resume_path == NULL) ? size : utf8_complete_length(data, size);
+}
+
+/**
+ *  \brief Record the offset and counting state to resume a file from in the next run.
+ *
+ *  Operation carried out by the worker that finishes the file, so each point is written by one thread.
+ *
+ *  \param file_index index of the file.
+ *  \param data first byte of the file.
+ *  \param offset bytes counted, as returned by resume_limit.
+ *  \param state counting state after them.
+ */
+
+void set_resume_point(int file_index, const unsigned char *data, size_t offset, const CountState *state) {
+  ResumePoint *p;
+
+  if (resume_path == NULL || !points[file_index].regular)
+    return;
+
+  p = &points[file_index];
+  p->end.dev = p->dev;
+  p->end.ino = p->ino;
+  p->end.offset = offset;
+  p->end.tail_hash = tail_hash(data, offset);
+  p->end.state = *state;
+  p->recorded = 1;
+}
+
+/**
+ *  \brief Save the states of the counted files.
+ *
+ *  Operation carried out by the main thread, after the workers have terminated. The state file is rewritten
+ *  through a temporary file and a rename.
+ */
+
+void store_resume_points(void) {
+  long old_entries = num_entries;
+  ResumeEntry *e;
+  char *tmp_path;
+  FILE *fp;
+
+  if (resume_path == NULL)
+    return;
+
+  entries = realloc(entries, (num_entries + num_points) * sizeof(ResumeEntry));
+
+  for (int i = 0; i < num_points; i++) {
+    if (!points[i].recorded)
+      continue;
+    if ((e = bsearch(&points[i].end, entries, old_entries, sizeof(ResumeEntry), compare_entries)) == NULL)
+      e = &entries[num_entries++];
+    *e = points[i].end;
+  }
+
+  tmp_path = malloc(strlen(resume_path) + 5);
+  sprintf(tmp_path, "%s.tmp", resume_path);
+
+  if ((fp = fopen(tmp_path, "w")) == NULL) {
+    perror("error on writing the resume state");
+    free(tmp_path);
+    return;
+  }
+
+  fprintf(fp, "%s\n", RESUME_HEADER);
+  for (long j = 0; j < num_entries; j++)
+    fprintf(fp, "%llu %llu %lld %llx %ld %ld %ld %d %d\n", entries[j].dev, entries[j].ino, entries[j].offset,
+            entries[j].tail_hash, entries[j].state.total_num_words, entries[j].state.num_vowels,
+            entries[j].state.num_cons, entries[j].state.value_before, entries[j].state.end_of_word);
+
+  if (fclose(fp) != 0 || rename(tmp_path, resume_path) != 0)
+    perror("error on writing the resume state");
+
+  free(tmp_path);
+  free(points);
+  free(entries);
+}
@@ -0,0 +1,48 @@
+/**
+ *  \file resumeState.h (interface file)
+ *
+ *  \brief Problem name: Total number of words, number of words beginning with a vowel and ending with a consonant.
+ *
+ *  Incremental counting of append-only files.
+ *  The counting state of every regular file at the end of a run (byte offset, previous char, end of word flag
+ *  and the running counts) is saved, so that the next run only counts the bytes appended since.
+ *
+ *  Definition of the operations carried out by the workers:
+ *     \li get_resume_point
+ *     \li resume_limit
+ *     \li set_resume_point.
+ *
+ *  Definition of the operations carried out by the main thread:
+ *     \li init_resume
+ *     \li lookup_resume_points
+ *     \li store_resume_points.
+ *
+ *  \author Eduardo Santos and Pedro Bastos - April 2022
+ */
+
+#ifndef RESUMESTATE_H_
+#define RESUMESTATE_H_
+
+#include <stddef.h>
+
+#include "wordCount.h"
+
+/** \brief Load the saved states. */
+extern int init_resume(const char *path);
+
+/** \brief Find where each file is resumed. */
+extern void lookup_resume_points(void);
+
+/** \brief Offset and counting state a file is resumed from. */
+extern size_t get_resume_point(int file_index, size_t size, CountState *state);
+
+/** \brief End of the bytes of a file that can be counted and resumed from later. */
+extern size_t resume_limit(const unsigned char *data, size_t size);
+
+/** \brief Record the offset and counting state to resume a file from in the next run. */
+extern void set_resume_point(int file_index, const unsigned char *data, size_t offset, const CountState *state);
+
+/** \brief Save the states of the counted files. */
+extern void store_resume_points(void);
+
+#endif /* RESUMESTATE_H_ */
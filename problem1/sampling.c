@@ -0,0 +1,419 @@
+/**
+ *  \file sampling.c (implementation file)
+ *
+ *  \brief Problem name: Total number of words, number of words beginning with a vowel and ending with a consonant.
+ *
+ *  Sampling mode.
+ *  Every file is split in blocks of SAMPLE_BLOCK bytes, their ends moved forward to the start of a UTF-8
+ *  sequence, and a simple random sample of the given fraction of the blocks (at least SAMPLE_MIN_BLOCKS) is
+ *  drawn without replacement. Each sampled block is a task of the work-stealing scheduler. Its worker decodes
+ *  the SAMPLE_LOOKBACK bytes before it to learn whether the block starts inside a word and then counts the
+ *  block as a file would be counted from that state: a word is counted in the block where it starts and a
+ *  consonant-final word in the block where it ends, so the counts of all the blocks of a file add up to the
+ *  counts of the file. Only the sampled blocks are read from the mapping, so the cost follows the size of the
+ *  sample, not the size of the files.
+ *
+ *  The counts of a file are estimated with the ratio estimator, the counts per byte of the sample times the
+ *  size of the file, which also fits the shorter last block; the variance follows from the residuals of the
+ *  blocks, with the finite population correction, and gives a 95% confidence interval from the Student t
+ *  distribution, as samples of a few blocks are common. The files are sampled independently, so the estimates
+ *  of the totals are the sums of those of the files and their half widths add in quadrature.
+ *
+ *  Definition of the operations carried out by the workers:
+ *     \li get_sample_task
+ *     \li count_sample_task.
+ *
+ *  Definition of the operations carried out by the main thread:
+ *     \li init_sampling
+ *     \li save_sample_results
+ *     \li print_sample_stats
+ *     \li free_sampling.
+ *
+ *  \author Eduardo Santos and Pedro Bastos - April 2022
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "probConst.h"
+#include "wordCount.h"
+#include "fileReader.h"
+#include "scheduler.h"
+
+/** \brief array of the filenames retrieved from the main file */
+extern char **filenames;
+
+/** \brief variable to save the number of files */
+extern int num_files;
+
+/** \brief array to save the total number of words for each file */
+extern long *array_num_words;
+
+/** \brief array to save the number of words beginning with a vowel for each file */
+extern long *array_num_vowels;
+
+/** \brief array to save the number of words ending with a consonant for each file */
+extern long *array_num_cons;
+
+/** \brief array to save the number of bytes read from each file */
+extern long *array_num_bytes;
+
+/** \brief array to save the number of words counted from the bytes read from each file in this run */
+extern long *array_run_words;
+
+/** \brief quantile of the normal distribution for a 95% confidence interval */
+#define CONFIDENCE_Z    1.959964
+
+/** \brief quantiles of the Student t distribution for a 95% confidence interval, by degrees of freedom */
+static const double t_975[31] = { 0.0, 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                                  2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                                  2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042 };
+
+/** \brief number of counts estimated: words, vowel-initial words and consonant-final words */
+#define NUM_COUNTS      3
+
+/** \brief a sampled block and the result of counting it */
+typedef struct {
+  int file_index;                                                                                   /* file */
+  long block;                                                                            /* block of the file */
+  long bytes;                                                                          /* bytes of the block */
+  long counts[NUM_COUNTS];                                                              /* counts of the block */
+} __attribute__((aligned(CACHE_LINE))) SampleTask;
+
+/** \brief a file being sampled and its estimates */
+typedef struct {
+  MappedFile map;                                                                     /* contents of the file */
+  long num_blocks;                                                                   /* blocks of the file */
+  long num_sampled;                                                                        /* blocks sampled */
+  int first_task;                                                           /* task of the first sampled block */
+  double estimate[NUM_COUNTS];                                                            /* estimated counts */
+  double half_width[NUM_COUNTS];                                   /* half widths of the confidence intervals */
+} SampleFile;
+
+/** \brief files being sampled */
+static SampleFile *files;
+
+/** \brief every task, the blocks of each file consecutive and in file order */
+static SampleTask *tasks;
+
+/** \brief number of tasks */
+static int num_tasks;
+
+/** \brief fraction of the blocks sampled */
+static double sample_fraction;
+
+/**
+ *  \brief Insert a block in a set of blocks.
+ *
+ *  \param set open addressing table, -1 for an empty entry.
+ *  \param mask size of the table minus one, the size being a power of two.
+ *  \param block block.
+ *  \return 1 if it was inserted, 0 if it was there already.
+ */
+
+static int insert_block(long *set, unsigned long mask, long block) {
+  unsigned long h = ((unsigned long)block * 0x9E3779B97F4A7C15ul) & mask;
+
+  while (set[h] != -1) {
+    if (set[h] == block)
+      return 0;
+    h = (h + 1) & mask;
+  }
+  set[h] = block;
+
+  return 1;
+}
+
+/**
+ *  \brief Compare two blocks.
+ */
+
+static int compare_blocks(const void *a, const void *b) {
+  const SampleTask *x = a, *y = b;
+
+  return (x->block > y->block) - (x->block < y->block);
+}
+
+/**
+ *  \brief Draw n distinct blocks out of num_blocks, in increasing order.
+ *
+ *  Floyd's algorithm, so the cost depends on n only.
+ *
+ *  \param num_blocks number of blocks of the file.
+ *  \param n number of blocks to draw.
+ *  \param seed state of the random generator.
+ *  \param out where the tasks of the blocks are stored.
+ *  \return 1 for Success and 0 for Failure.
+ */
+
+static int draw_blocks(long num_blocks, long n, unsigned short seed[3], SampleTask *out) {
+  unsigned long size = 1;
+  long *set, pick;
+
+  while (size < 2 * (unsigned long)n)
+    size <<= 1;
+  if ((set = malloc(size * sizeof(long))) == NULL) {
+    perror("error on drawing the blocks");
+    return 0;
+  }
+  memset(set, 0xFF, size * sizeof(long));
+
+  for (long j = num_blocks - n, k = 0; j < num_blocks; j++, k++) {
+    pick = (long)(erand48(seed) * (j + 1));
+    if (pick > j)
+      pick = j;
+    if (!insert_block(set, size - 1, pick)) {
+      pick = j;
+      insert_block(set, size - 1, pick);
+    }
+    out[k].block = pick;
+  }
+  free(set);
+
+  qsort(out, n, sizeof(SampleTask), compare_blocks);
+
+  return 1;
+}
+
+/**
+ *  \brief Draw the blocks of every file to be counted.
+ *
+ *  Operation carried out by the main thread. The files are mapped here, which reads nothing yet; only regular
+ *  files can be sampled.
+ *
+ *  \param fraction fraction of the blocks of each file to be counted.
+ *  \return 1 for Success and 0 for Failure.
+ */
+
+int init_sampling(double fraction) {
+  unsigned short seed[3];
+  unsigned long mix = (unsigned long)time(NULL) ^ ((unsigned long)getpid() << 16);
+  long total = 0, n;
+  struct stat st;
+
+  sample_fraction = fraction;
+  seed[0] = mix & 0xFFFF;
+  seed[1] = (mix >> 16) & 0xFFFF;
+  seed[2] = (mix >> 32) & 0xFFFF;
+
+  if ((files = calloc(num_files, sizeof(SampleFile))) == NULL) {
+    perror("error on allocating the files");
+    return 0;
+  }
+
+  for (int i = 0; i < num_files; i++) {
+    if (stat(filenames[i], &st) != 0) {
+      fprintf(stderr, "Error! File %s not found.\n", filenames[i]);
+      return 0;
+    }
+    if (!S_ISREG(st.st_mode)) {
+      fprintf(stderr, "Error! File %s is not a regular file and cannot be sampled.\n", filenames[i]);
+      return 0;
+    }
+
+    files[i].num_blocks = (st.st_size + SAMPLE_BLOCK - 1) / SAMPLE_BLOCK;
+    n = (long)ceil(fraction * files[i].num_blocks);
+    if (n < SAMPLE_MIN_BLOCKS)
+      n = SAMPLE_MIN_BLOCKS;
+    if (n > files[i].num_blocks)
+      n = files[i].num_blocks;
+    files[i].num_sampled = n;
+    files[i].first_task = total;
+    total += n;
+  }
+
+  num_tasks = total;
+  if (posix_memalign((void **)&tasks, CACHE_LINE, (total + 1) * sizeof(SampleTask)) != 0) {
+    perror("error on allocating the tasks");
+    return 0;
+  }
+
+  for (int i = 0; i < num_files; i++) {
+    if (files[i].num_blocks > 0 && !map_file(filenames[i], &files[i].map)) {
+      fprintf(stderr, "Error! File %s cannot be opened.\n", filenames[i]);
+      return 0;
+    }
+    if (files[i].map.mapped)                                            /* no read ahead of the blocks skipped */
+      madvise(files[i].map.data, files[i].map.size, MADV_RANDOM);
+
+    if (!draw_blocks(files[i].num_blocks, files[i].num_sampled, seed, &tasks[files[i].first_task]))
+      return 0;
+    for (long k = 0; k < files[i].num_sampled; k++)
+      tasks[files[i].first_task + k].file_index = i;
+  }
+
+  return init_scheduler(num_tasks);
+}
+
+/**
+ *  \brief Hand out the next task.
+ *
+ *  Operation carried out by the workers.
+ *
+ *  \param id worker identification.
+ *  \return index of the task, or -1 when every task was counted or is being counted.
+ */
+
+int get_sample_task(unsigned int id) {
+  return get_task(id);
+}
+
+/**
+ *  \brief Count a sampled block.
+ *
+ *  Operation carried out by the workers. Each task is written by the worker that counts it only.
+ *
+ *  \param id worker identification.
+ *  \param t index of the task.
+ */
+
+void count_sample_task(unsigned int id, int t) {
+  SampleTask *task = &tasks[t];
+  SampleFile *file = &files[task->file_index];
+  const unsigned char *data = file->map.data;
+  size_t size = file->map.size;
+  size_t start = (size_t)task->block * SAMPLE_BLOCK;
+  size_t end = (start + SAMPLE_BLOCK < size) ? start + SAMPLE_BLOCK : size;
+  size_t from;
+  CountState state;
+
+  (void)id;
+
+  if (start > size)                                                     /* the file shrank since it was sized */
+    start = end = size;
+  if (start > 0)
+    start = align_chunk(data, size, start);
+  end = align_chunk(data, size, end);
+
+  /* the bytes just before the block tell whether it starts inside a word, their counts are dropped */
+  init_count_state(&state);
+  if (start > 0) {
+    from = (start > SAMPLE_LOOKBACK) ? start - SAMPLE_LOOKBACK : 0;
+    from = align_chunk(data, start, from);
+    count_buffer(&state, data + from, start - from);
+    state.total_num_words = state.num_vowels = state.num_cons = 0;
+  }
+
+  if (end > start)
+    count_buffer(&state, data + start, end - start);
+
+  task->bytes = (end > start) ? end - start : 0;
+  task->counts[0] = state.total_num_words;
+  task->counts[1] = state.num_vowels;
+  task->counts[2] = state.num_cons;
+}
+
+/**
+ *  \brief Quantile of the Student t distribution for a 95% confidence interval.
+ *
+ *  \param df degrees of freedom.
+ *  \return quantile, from the table up to 30 degrees and from its expansion around the normal quantile above.
+ */
+
+static double t_quantile(long df) {
+  double z = CONFIDENCE_Z;
+
+  if (df <= 30)
+    return t_975[(df > 0) ? df : 0];
+
+  return z + (z * z * z + z) / (4.0 * df) + (5.0 * pow(z, 5) + 16.0 * z * z * z + 3.0 * z) / (96.0 * df * df);
+}
+
+/**
+ *  \brief Estimate the counts of every file from its sampled blocks.
+ *
+ *  Operation carried out by the main thread, after the workers have terminated. The estimates, rounded, are
+ *  stored in the results arrays, and the bytes and words of the sampled blocks as those read in this run.
+ */
+
+void save_sample_results(void) {
+  for (int i = 0; i < num_files; i++) {
+    SampleFile *file = &files[i];
+    SampleTask *blocks = &tasks[file->first_task];
+    long n = file->num_sampled, sum_x = 0, sampled_words = 0;
+    double f = (file->num_blocks > 0) ? (double)n / file->num_blocks : 1.0;
+
+    for (long k = 0; k < n; k++) {
+      sum_x += blocks[k].bytes;
+      sampled_words += blocks[k].counts[0];
+    }
+
+    for (int c = 0; c < NUM_COUNTS; c++) {
+      double sum_y = 0.0, ratio, d, s2 = 0.0;
+
+      for (long k = 0; k < n; k++)
+        sum_y += blocks[k].counts[c];
+      ratio = (sum_x > 0) ? sum_y / sum_x : 0.0;
+
+      for (long k = 0; k < n; k++) {
+        d = blocks[k].counts[c] - ratio * blocks[k].bytes;
+        s2 += d * d;
+      }
+      s2 = (n > 1) ? s2 / (n - 1) : 0.0;
+
+      file->estimate[c] = ratio * file->map.size;
+      file->half_width[c] = t_quantile(n - 1) *
+                            sqrt((double)file->num_blocks * file->num_blocks * (1.0 - f) * s2 / ((n > 0) ? n : 1));
+    }
+
+    array_num_words[i] = lround(file->estimate[0]);
+    array_num_vowels[i] = lround(file->estimate[1]);
+    array_num_cons[i] = lround(file->estimate[2]);
+    array_num_bytes[i] = sum_x;
+    array_run_words[i] = sampled_words;                          /* the throughput is that of the sample */
+  }
+}
+
+/**
+ *  \brief Print the confidence intervals of the estimates.
+ *
+ *  Operation carried out by the main thread, after save_sample_results.
+ */
+
+void print_sample_stats(void) {
+  static const char *names[NUM_COUNTS] = { "Total number of words", "N. of words beginning with a vowel",
+                                           "N. of words ending with a consonant" };
+  double total[NUM_COUNTS] = { 0.0 }, squares[NUM_COUNTS] = { 0.0 };
+  long sampled = 0, blocks = 0;
+
+  printf("Sampled estimates, %.2f %% of the blocks of %d bytes, 95 %% confidence intervals:\n",
+         100.0 * sample_fraction, SAMPLE_BLOCK);
+
+  for (int i = 0; i < num_files; i++) {
+    printf("Estimates of %s (%ld of %ld blocks)\n", filenames[i], files[i].num_sampled, files[i].num_blocks);
+    for (int c = 0; c < NUM_COUNTS; c++) {
+      printf("%s = %.0f +- %.0f\n", names[c], files[i].estimate[c], files[i].half_width[c]);
+      total[c] += files[i].estimate[c];
+      squares[c] += files[i].half_width[c] * files[i].half_width[c];
+    }
+    sampled += files[i].num_sampled;
+    blocks += files[i].num_blocks;
+    printf("\n");
+  }
+
+  printf("All the files (%ld of %ld blocks)\n", sampled, blocks);
+  for (int c = 0; c < NUM_COUNTS; c++)
+    printf("%s = %.0f +- %.0f\n", names[c], total[c], sqrt(squares[c]));
+}
+
+/**
+ *  \brief Release the files and the tasks.
+ *
+ *  Operation carried out by the main thread, after the workers have terminated.
+ */
+
+void free_sampling(void) {
+  for (int i = 0; i < num_files; i++)
+    if (files[i].num_blocks > 0)
+      unmap_file(&files[i].map);
+
+  free_scheduler();
+  free(tasks);
+  free(files);
+}
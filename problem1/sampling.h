@@ -0,0 +1,44 @@
+/**
+ *  \file sampling.h (interface file)
+ *
+ *  \brief Problem name: Total number of words, number of words beginning with a vowel and ending with a consonant.
+ *
+ *  Sampling mode.
+ *  Only a random fraction of the fixed size blocks of each file is counted, and the three counts of the file
+ *  are estimated from them, with a 95% confidence interval.
+ *
+ *  Definition of the operations carried out by the workers:
+ *     \li get_sample_task
+ *     \li count_sample_task.
+ *
+ *  Definition of the operations carried out by the main thread:
+ *     \li init_sampling
+ *     \li save_sample_results
+ *     \li print_sample_stats
+ *     \li free_sampling.
+ *
+ *  \author Eduardo Santos and Pedro Bastos - April 2022
+ */
+
+#ifndef SAMPLING_H_
+#define SAMPLING_H_
+
+/** \brief Draw the blocks of every file to be counted. */
+extern int init_sampling(double fraction);
+
+/** \brief Hand out the next task. */
+extern int get_sample_task(unsigned int id);
+
+/** \brief Count a sampled block. */
+extern void count_sample_task(unsigned int id, int t);
+
+/** \brief Estimate the counts of every file from its sampled blocks. */
+extern void save_sample_results(void);
+
+/** \brief Print the confidence intervals of the estimates. */
+extern void print_sample_stats(void);
+
+/** \brief Release the files and the tasks. */
+extern void free_sampling(void);
+
+#endif /* SAMPLING_H_ */
@@ -0,0 +1,195 @@
+/**
+ *  \file scheduler.c (implementation file)
+ *
+ *  \brief Problem name: Total number of words, number of words beginning with a vowel and ending with a consonant.
+ *
+ *  Work-stealing scheduler.
+ *  Every worker owns a deque of task indexes, filled with a contiguous share of the tasks so that it starts
+ *  on files of its own. A worker takes its own tasks from the front, in file order, and once its deque is
+ *  empty it steals from the back of the others' deques, where the work is farthest from what their owners
+ *  are counting. Each deque has its own lock, so workers only meet when one of them steals.
+ *
+ *  The idle time of a worker is the time it spent looking for a task to steal plus the time from when it found
+ *  no task left to when the last worker found none, that is, to the end of the run.
+ *
+ *  Definition of the operations carried out by the workers:
+ *     \li get_task.
+ *
+ *  Definition of the operations carried out by the main thread:
+ *     \li init_scheduler
+ *     \li print_scheduler_stats
+ *     \li free_scheduler.
+ *
+ *  \author Eduardo Santos and Pedro Bastos - April 2022
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "probConst.h"
+#include "wordCount.h"
+
+/** \brief number of workers */
+extern unsigned int num_workers;
+
+/** \brief deque of a worker and its counters, on cache lines of its own */
+typedef struct {
+  pthread_mutex_t lock;                                                        /* protects head and tail */
+  int *items;                                                                           /* task indexes */
+  int head;                                                             /* next task of the owner */
+  int tail;                                                            /* one past the last task */
+  long tasks_run;                                                         /* tasks taken by the owner */
+  long steals;                                                       /* tasks stolen by the owner */
+  long idle_ns;                                             /* time spent looking for a task to steal */
+  long long end_ns;                                       /* when no task was left for it, 0 until then */
+} __attribute__((aligned(CACHE_LINE))) TaskDeque;
+
+/** \brief deque of each worker */
+static TaskDeque *deques;
+
+/** \brief task indexes, shared out among the deques */
+static int *task_items;
+
+/**
+ *  \brief Share the tasks among the deques of the workers.
+ *
+ *  Operation carried out by the main thread. Worker i gets the i-th of num_workers contiguous slices of the
+ *  tasks.
+ *
+ *  \param num_tasks number of tasks, numbered from 0.
+ *  \return 1 for Success and 0 for Failure.
+ */
+
+int init_scheduler(int num_tasks) {
+  if (posix_memalign((void **)&deques, CACHE_LINE, num_workers * sizeof(TaskDeque)) != 0) {
+    perror("error on allocating deques");
+    return 0;
+  }
+
+  task_items = malloc((num_tasks > 0 ? num_tasks : 1) * sizeof(int));
+  for (int t = 0; t < num_tasks; t++)
+    task_items[t] = t;
+
+  for (int i = 0; i < num_workers; i++) {
+    pthread_mutex_init(&deques[i].lock, NULL);
+    deques[i].items = task_items;
+    deques[i].head = (int)((long)num_tasks * i / num_workers);
+    deques[i].tail = (int)((long)num_tasks * (i + 1) / num_workers);
+    deques[i].tasks_run = 0;
+    deques[i].steals = 0;
+    deques[i].idle_ns = 0;
+    deques[i].end_ns = 0;
+  }
+
+  return 1;
+}
+
+/**
+ *  \brief Take a task from the front of a worker's own deque.
+ *
+ *  \param dq deque.
+ *  \return task index, or -1 if the deque is empty.
+ */
+
+static int pop_front(TaskDeque *dq) {
+  int t = -1;
+
+  pthread_mutex_lock(&dq->lock);
+  if (dq->head < dq->tail)
+    t = dq->items[dq->head++];
+  pthread_mutex_unlock(&dq->lock);
+
+  return t;
+}
+
+/**
+ *  \brief Take a task from the back of another worker's deque.
+ *
+ *  \param dq deque.
+ *  \return task index, or -1 if the deque is empty.
+ */
+
+static int steal_back(TaskDeque *dq) {
+  int t = -1;
+
+  pthread_mutex_lock(&dq->lock);
+  if (dq->head < dq->tail)
+    t = dq->items[--dq->tail];
+  pthread_mutex_unlock(&dq->lock);
+
+  return t;
+}
+
+/**
+ *  \brief Take the next task of a worker, stealing one if its deque is empty.
+ *
+ *  Operation carried out by the workers. The victims are tried in turn starting from the next worker; as no
+ *  task is added after the start, a round with every deque empty means the work is over.
+ *
+ *  \param id worker identification.
+ *  \return task index, or -1 when there are no tasks left.
+ */
+
+int get_task(unsigned int id) {
+  TaskDeque *own = &deques[id];
+  struct timespec begin, finish;
+  int t;
+
+  if ((t = pop_front(own)) != -1) {
+    own->tasks_run++;
+    return t;
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &begin);
+
+  for (int i = 1; i < num_workers && t == -1; i++)
+    t = steal_back(&deques[(id + i) % num_workers]);
+
+  clock_gettime(CLOCK_MONOTONIC, &finish);
+  own->idle_ns += (finish.tv_sec - begin.tv_sec) * 1000000000L + (finish.tv_nsec - begin.tv_nsec);
+
+  if (t != -1)
+    own->steals++;
+  else if (own->end_ns == 0)
+    own->end_ns = finish.tv_sec * 1000000000LL + finish.tv_nsec;
+
+  return t;
+}
+
+/**
+ *  \brief Print the tasks, steals and idle time of each worker.
+ *
+ *  Operation carried out by the main thread, after the workers have terminated.
+ */
+
+void print_scheduler_stats(void) {
+  long long run_end = 0;
+
+  for (int i = 0; i < num_workers; i++)
+    if (deques[i].end_ns > run_end)
+      run_end = deques[i].end_ns;
+
+  printf("Scheduler balance:\n");
+  for (int i = 0; i < num_workers; i++) {
+    long long waited = (deques[i].end_ns > 0) ? run_end - deques[i].end_ns : 0;        /* after its last task */
+
+    printf("worker %d: own tasks = %ld, stolen tasks = %ld, idle time = %.6f s\n",
+           i, deques[i].tasks_run, deques[i].steals, (deques[i].idle_ns + waited) / 1000000000.0);
+  }
+}
+
+/**
+ *  \brief Release the deques.
+ *
+ *  Operation carried out by the main thread, after the workers have terminated.
+ */
+
+void free_scheduler(void) {
+  for (int i = 0; i < num_workers; i++)
+    pthread_mutex_destroy(&deques[i].lock);
+
+  free(task_items);
+  free(deques);
+}
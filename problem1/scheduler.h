@@ -0,0 +1,36 @@
+/**
+ *  \file scheduler.h (interface file)
+ *
+ *  \brief Problem name: Total number of words, number of words beginning with a vowel and ending with a consonant.
+ *
+ *  Work-stealing scheduler.
+ *  Every worker owns a deque of task indexes, filled with a contiguous share of the tasks. A worker takes
+ *  its own tasks from the front and, once its deque is empty, steals from the back of the others' deques.
+ *
+ *  Definition of the operations carried out by the workers:
+ *     \li get_task.
+ *
+ *  Definition of the operations carried out by the main thread:
+ *     \li init_scheduler
+ *     \li print_scheduler_stats
+ *     \li free_scheduler.
+ *
+ *  \author Eduardo Santos and Pedro Bastos - April 2022
+ */
+
+#ifndef SCHEDULER_H_
+#define SCHEDULER_H_
+
+/** \brief Share the tasks among the deques of the workers. */
+extern int init_scheduler(int num_tasks);
+
+/** \brief Take the next task of a worker, stealing one if its deque is empty. */
+extern int get_task(unsigned int id);
+
+/** \brief Print the tasks, steals and idle time of each worker. */
+extern void print_scheduler_stats(void);
+
+/** \brief Release the deques. */
+extern void free_scheduler(void);
+
+#endif /* SCHEDULER_H_ */
@@ -0,0 +1,856 @@
+/**
+ *  \file service.c (implementation file)
+ *
+ *  \brief Problem name: Total number of words, number of words beginning with a vowel and ending with a consonant.
+ *
+ *  Resident service.
+ *  A request is a text header followed by its items, each a path or inline bytes:
+ *
+ *      COUNT <number of items>\n
+ *      FILE <path>\n
+ *      DATA <number of bytes>\n<bytes>
+ *
+ *  and is answered with one line per item, in order: "OK <words> <vowels> <consonants> <bytes>" or
+ *  "ERR <reason>". A connection may send any number of requests, one after the other; the next one is read
+ *  once the previous one was answered.
+ *
+ *  The main thread polls the socket and the connections. The requests completed by the bytes read in a round
+ *  are split in jobs, a file or buffer up to CHUNK_SIZE bytes being a single job and larger ones a job per
+ *  chunk, and queued together under one acquisition of the queue lock. The workers, created once, take the
+ *  jobs in order; the one that counts the last chunk of an item merges it, and the one that finishes the last
+ *  item of a request writes the answer and hands the connection back to the main thread through a pipe.
+ *
+ *  Small files are mapped by the worker that counts them, larger ones by the main thread so that their chunks
+ *  share the mapping. Only regular files are accepted, a pipe could block a worker indefinitely.
+ *
+ *  The queue of jobs is a monitor. SIGINT and SIGTERM stop the service: the main thread stops accepting,
+ *  the workers finish the queued jobs and terminate, and the socket is removed.
+ *
+ *  Definition of the operations carried out by the workers:
+ *     \li get_service_job
+ *     \li run_service_job.
+ *
+ *  Definition of the operations carried out by the main thread:
+ *     \li init_service
+ *     \li serve_requests
+ *     \li print_service_stats
+ *     \li free_service.
+ *
+ *  \author Eduardo Santos and Pedro Bastos - April 2022
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "probConst.h"
+#include "wordCount.h"
+#include "fileReader.h"
+#include "service.h"
+
+/** \brief worker threads return status array */
+extern int *statusCons;
+
+/** \brief longest header line of a request */
+#define LINE_MAX_LEN   4200
+
+/** \brief initial size of the buffer of a connection */
+#define CONN_BUFFER    65536
+
+/** \brief reason given for a path that is not a regular file */
+#define ERR_NOT_REGULAR   (-1)
+
+/** \brief a client connection */
+typedef struct {
+  int fd;                                                                                    /* socket */
+  unsigned char *buf;                                                          /* bytes not handled yet */
+  size_t len;                                                                     /* number of bytes in buf */
+  size_t cap;                                                                               /* size of buf */
+  int busy;                                          /* 1 while a request is being counted, atomic */
+} Connection;
+
+/** \brief a request being counted */
+typedef struct {
+  Connection *conn;                                                                 /* where to answer */
+  unsigned char *buf;                                               /* bytes of the request, paths and data */
+  struct ServiceItem *items;                                                                  /* items */
+  int num_items;                                                                        /* number of items */
+  int pending;                                   /* items not counted yet, plus one while queueing, atomic */
+} ServiceRequest;
+
+/** \brief an item of a request */
+struct ServiceItem {
+  ServiceRequest *req;                                                                       /* request */
+  const char *path;                                                          /* file, NULL for inline data */
+  const unsigned char *data;                              /* bytes, NULL for a file mapped by its worker */
+  size_t size;                                                                         /* number of bytes */
+  MappedFile map;                                                    /* mapping of a large file */
+  int mapped;                                                             /* 1 if map must be released */
+  int err;                                                  /* errno of a failure, or ERR_NOT_REGULAR */
+  int num_chunks;                                                                      /* number of jobs */
+  int chunks_left;                                                          /* jobs not counted, atomic */
+  ChunkResult *res;                                                    /* result of each chunk, if several */
+  CountState state;                                                                           /* result */
+};
+
+/** \brief path of the socket */
+static const char *socket_path;
+
+/** \brief listening socket */
+static int listen_fd = -1;
+
+/** \brief pipe the workers write to when they hand a connection back */
+static int wake_pipe[2];
+
+/** \brief signal mask of the main thread while it polls */
+static sigset_t poll_mask;
+
+/** \brief flag set by SIGINT and SIGTERM */
+static volatile sig_atomic_t stop_requested = 0;
+
+/** \brief open connections */
+static Connection **conns;
+
+/** \brief number of open connections */
+static int num_conns = 0;
+
+/** \brief queued jobs, a circular buffer */
+static ServiceJob *queue;
+
+/** \brief first queued job */
+static long queue_head = 0;
+
+/** \brief number of queued jobs */
+static long queue_len = 0;
+
+/** \brief size of the queue */
+static long queue_cap = 0;
+
+/** \brief flag that indicates the workers must terminate once the queue is empty */
+static int stopping = 0;
+
+/** \brief requests answered */
+static long requests_served = 0;
+
+/** \brief items answered */
+static long items_served = 0;
+
+/** \brief locking flag which warrants mutual exclusion inside the monitor */
+static pthread_mutex_t queue_access = PTHREAD_MUTEX_INITIALIZER;
+
+/** \brief condition which warrants that there is a job, or the service is stopping */
+static pthread_cond_t job_ready;
+
+/**
+ *  \brief Signal handler of SIGINT and SIGTERM.
+ */
+
+static void request_stop(int sig) {
+  (void)sig;
+  stop_requested = 1;
+}
+
+/**
+ *  \brief Create the socket of the service and the queue of jobs.
+ *
+ *  Operation carried out by the main thread, before the workers are created: SIGINT and SIGTERM are blocked
+ *  here, so that the workers inherit the mask and the signals reach the main thread, which takes them only
+ *  while it polls. A socket left behind by a service that is gone is replaced.
+ *
+ *  \param path path of the socket.
+ *  \return 1 for Success and 0 for Failure.
+ */
+
+int init_service(const char *path) {
+  struct sockaddr_un addr;
+  struct sigaction sa;
+  sigset_t block;
+  int probe;
+
+  if (strlen(path) >= sizeof(addr.sun_path)) {
+    fprintf(stderr, "Error! Socket path %s is too long.\n", path);
+    return 0;
+  }
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, path);
+
+  if ((listen_fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) {
+    perror("error on creating the socket");
+    return 0;
+  }
+
+  if (bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+    if (errno != EADDRINUSE || (probe = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) {
+      perror("error on binding the socket");
+      return 0;
+    }
+    if (connect(probe, (struct sockaddr *)&addr, sizeof(addr)) == 0) {
+      fprintf(stderr, "Error! A service is already listening on %s.\n", path);
+      close(probe);
+      return 0;
+    }
+    close(probe);
+    unlink(path);                                                                          /* stale socket */
+    if (bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+      perror("error on binding the socket");
+      return 0;
+    }
+  }
+  socket_path = path;
+
+  if (listen(listen_fd, SERVICE_BACKLOG) != 0 || fcntl(listen_fd, F_SETFL, O_NONBLOCK) != 0
+      || pipe(wake_pipe) != 0 || fcntl(wake_pipe[0], F_SETFL, O_NONBLOCK) != 0
+      || fcntl(wake_pipe[1], F_SETFL, O_NONBLOCK) != 0) {
+    perror("error on setting up the service");
+    return 0;
+  }
+
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = request_stop;
+  sigemptyset(&sa.sa_mask);
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+  signal(SIGPIPE, SIG_IGN);
+
+  sigemptyset(&block);
+  sigaddset(&block, SIGINT);
+  sigaddset(&block, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &block, &poll_mask);
+  sigdelset(&poll_mask, SIGINT);
+  sigdelset(&poll_mask, SIGTERM);
+
+  queue_cap = 1024;
+  queue = malloc(queue_cap * sizeof(ServiceJob));
+  conns = NULL;
+  pthread_cond_init(&job_ready, NULL);
+
+  printf("Service listening on %s\n", path);
+  fflush(stdout);
+
+  return 1;
+}
+
+/**
+ *  \brief Queue the jobs of the requests read in a round.
+ *
+ *  Operation carried out by the main thread.
+ *
+ *  \param jobs jobs.
+ *  \param n number of jobs.
+ */
+
+static void queue_jobs(const ServiceJob *jobs, long n) {
+  int status;
+
+  if (n == 0)
+    return;
+
+  if ((status = pthread_mutex_lock(&queue_access)) != 0) {                                     /* enter monitor */
+    errno = status;                                                                        /* save error in errno */
+    perror("error on entering monitor(QJ)");
+    exit(EXIT_FAILURE);
+  }
+
+  if (queue_len + n > queue_cap) {                                  /* grow, unwrapping the circular buffer */
+    long cap = queue_cap;
+    ServiceJob *grown;
+
+    while (queue_len + n > cap)
+      cap *= 2;
+    if ((grown = malloc(cap * sizeof(ServiceJob))) == NULL) {
+      perror("error on allocating the queue of jobs");
+      exit(EXIT_FAILURE);
+    }
+    for (long k = 0; k < queue_len; k++)
+      grown[k] = queue[(queue_head + k) % queue_cap];
+    free(queue);
+    queue = grown;
+    queue_cap = cap;
+    queue_head = 0;
+  }
+
+  for (long k = 0; k < n; k++)
+    queue[(queue_head + queue_len + k) % queue_cap] = jobs[k];
+  queue_len += n;
+
+  if ((status = (n > 1) ? pthread_cond_broadcast(&job_ready) : pthread_cond_signal(&job_ready)) != 0) {
+    errno = status;                                                                        /* save error in errno */
+    perror("error on signaling in job_ready");
+    exit(EXIT_FAILURE);
+  }
+
+  if ((status = pthread_mutex_unlock(&queue_access)) != 0) {                                    /* exit monitor */
+    errno = status;                                                                        /* save error in errno */
+    perror("error on exiting monitor(QJ)");
+    exit(EXIT_FAILURE);
+  }
+}
+
+/**
+ *  \brief Take the next job, waiting for one.
+ *
+ *  Operation carried out by the workers.
+ *
+ *  \param id worker identification.
+ *  \param job where the job is stored.
+ *  \return 1 if there is a job, 0 when the service stopped and the queue is empty.
+ */
+
+int get_service_job(unsigned int id, ServiceJob *job) {
+  int got = 0;
+
+  if ((statusCons[id] = pthread_mutex_lock(&queue_access)) != 0) {                              /* enter monitor */
+    errno = statusCons[id];                                                                /* save error in errno */
+    perror("error on entering monitor(GJ)");
+    statusCons[id] = EXIT_FAILURE;
+    pthread_exit(&statusCons[id]);
+  }
+
+  while (queue_len == 0 && !stopping)                                                   /* wait for a job */
+    if ((statusCons[id] = pthread_cond_wait(&job_ready, &queue_access)) != 0) {
+      errno = statusCons[id];                                                              /* save error in errno */
+      perror("error on waiting in job_ready");
+      statusCons[id] = EXIT_FAILURE;
+      pthread_exit(&statusCons[id]);
+    }
+
+  if (queue_len > 0) {
+    *job = queue[queue_head];
+    queue_head = (queue_head + 1) % queue_cap;
+    queue_len--;
+    got = 1;
+  }
+
+  if ((statusCons[id] = pthread_mutex_unlock(&queue_access)) != 0) {                              /* exit monitor */
+    errno = statusCons[id];                                                                /* save error in errno */
+    perror("error on exiting monitor(GJ)");
+    statusCons[id] = EXIT_FAILURE;
+    pthread_exit(&statusCons[id]);
+  }
+
+  return got;
+}
+
+/**
+ *  \brief Release a request and the mappings of its items.
+ */
+
+static void free_request(ServiceRequest *req) {
+  for (int i = 0; i < req->num_items; i++) {
+    if (req->items[i].mapped)
+      unmap_file(&req->items[i].map);
+    free(req->items[i].res);
+  }
+  free(req->items);
+  free(req->buf);
+  free(req);
+}
+
+/**
+ *  \brief Write the answer of a request, release it and hand its connection back to the main thread.
+ *
+ *  Carried out by the thread that finishes the last item. A client that went away is ignored, the main
+ *  thread closes its connection when it reads the end of it.
+ *
+ *  \param req request.
+ */
+
+static void answer_request(ServiceRequest *req) {
+  Connection *conn = req->conn;
+  size_t cap = 96 * (size_t)req->num_items, len = 0;
+  char *out = malloc(cap);
+  char msg[128];
+  ssize_t n;
+
+  for (int i = 0; i < req->num_items; i++) {
+    struct ServiceItem *it = &req->items[i];
+
+    if (it->err == 0)
+      len += snprintf(out + len, cap - len, "OK %ld %ld %ld %zu\n", it->state.total_num_words, it->state.num_vowels,
+                      it->state.num_cons, it->size);
+    else
+      len += snprintf(out + len, cap - len, "ERR %.50s\n", (it->err == ERR_NOT_REGULAR) ? "not a regular file"
+                                                             : strerror_r(it->err, msg, sizeof(msg)));
+  }
+
+  for (size_t sent = 0; sent < len; sent += n)
+    if ((n = send(conn->fd, out + sent, len - sent, MSG_NOSIGNAL)) <= 0) {
+      if (n < 0 && errno == EINTR) {
+        n = 0;
+        continue;
+      }
+      break;
+    }
+
+  __atomic_add_fetch(&requests_served, 1, __ATOMIC_RELAXED);
+  __atomic_add_fetch(&items_served, req->num_items, __ATOMIC_RELAXED);
+
+  free(out);
+  free_request(req);
+
+  __atomic_store_n(&conn->busy, 0, __ATOMIC_RELEASE);
+  if (write(wake_pipe[1], "", 1) < 0 && errno != EAGAIN)                          /* a full pipe wakes it already */
+    perror("error on waking the main thread");
+}
+
+/**
+ *  \brief Account for a finished item, answering its request if it was the last one.
+ */
+
+static void item_done(ServiceRequest *req) {
+  if (__atomic_sub_fetch(&req->pending, 1, __ATOMIC_ACQ_REL) == 0)
+    answer_request(req);
+}
+
+/**
+ *  \brief Count a job and answer its request if it was the last one.
+ *
+ *  Operation carried out by the workers.
+ *
+ *  \param id worker identification.
+ *  \param job job.
+ */
+
+void run_service_job(unsigned int id, const ServiceJob *job) {
+  struct ServiceItem *it = job->item;
+  size_t start, end;
+  MappedFile mf;
+  int j = job->chunk;
+
+  (void)id;
+
+  if (it->num_chunks == 1) {
+    if (it->data == NULL) {                                                           /* a small file */
+      if (!map_file(it->path, &mf)) {
+        it->err = errno ? errno : EIO;
+        item_done(it->req);
+        return;
+      }
+      it->size = mf.size;
+      init_count_state(&it->state);
+      count_buffer(&it->state, mf.data, mf.size);
+      unmap_file(&mf);
+    }
+    else {
+      init_count_state(&it->state);
+      count_buffer(&it->state, it->data, it->size);
+    }
+    item_done(it->req);
+    return;
+  }
+
+  start = (j == 0) ? 0 : align_chunk(it->data, it->size, (size_t)j * CHUNK_SIZE);
+  end = (j == it->num_chunks - 1) ? it->size : align_chunk(it->data, it->size, (size_t)(j + 1) * CHUNK_SIZE);
+  count_chunk(it->data + start, end - start, &it->res[j]);
+
+  /* the last chunk to finish sees the results of all the others */
+  if (__atomic_sub_fetch(&it->chunks_left, 1, __ATOMIC_ACQ_REL) == 0) {
+    init_count_state(&it->state);
+    for (int c = 0; c < it->num_chunks; c++)
+      merge_chunk(&it->state, &it->res[c]);
+    item_done(it->req);
+  }
+}
+
+/**
+ *  \brief Copy a header line, ended by '\n', to a string.
+ *
+ *  \param p first byte of the line.
+ *  \param end end of the bytes read.
+ *  \param line where the line is stored, LINE_MAX_LEN + 1 bytes.
+ *  \return first byte after the line, NULL if the line is incomplete, or p if it is too long.
+ */
+
+static const unsigned char *get_line(const unsigned char *p, const unsigned char *end, char *line) {
+  const unsigned char *nl = memchr(p, '\n', end - p);
+
+  if (nl == NULL)
+    return (end - p > LINE_MAX_LEN) ? p : NULL;
+  if (nl - p > LINE_MAX_LEN)
+    return p;
+
+  memcpy(line, p, nl - p);
+  line[nl - p] = '\0';
+
+  return nl + 1;
+}
+
+/**
+ *  \brief Check whether the bytes of a connection start with a whole request.
+ *
+ *  \param buf bytes of the connection.
+ *  \param len number of bytes.
+ *  \param used where the length of the request is stored.
+ *  \param num_items where the number of items is stored.
+ *  \return 1 for a whole request, 0 if more bytes are needed and -1 for a malformed one.
+ */
+
+static int scan_request(const unsigned char *buf, size_t len, size_t *used, int *num_items) {
+  const unsigned char *p = buf, *end = buf + len, *next;
+  char line[LINE_MAX_LEN + 1];
+  unsigned long long size;
+  char *tail;
+  int n;
+
+  if ((next = get_line(p, end, line)) == NULL)
+    return 0;
+  if (next == p || sscanf(line, "COUNT %d", &n) != 1 || n < 1 || n > SERVICE_MAX_ITEMS)
+    return -1;
+  p = next;
+
+  for (int i = 0; i < n; i++) {
+    if ((next = get_line(p, end, line)) == NULL)
+      return 0;
+    if (next == p)
+      return -1;
+    p = next;
+
+    if (strncmp(line, "FILE ", 5) == 0 && line[5] != '\0')
+      continue;
+    if (strncmp(line, "DATA ", 5) != 0 || line[5] < '0' || line[5] > '9')
+      return -1;
+
+    errno = 0;
+    size = strtoull(line + 5, &tail, 10);
+    if (errno != 0 || *tail != '\0' || size > SERVICE_MAX_REQUEST)
+      return -1;
+    if ((size_t)(end - p) < size)
+      return 0;
+    p += size;
+  }
+
+  *used = p - buf;
+  *num_items = n;
+
+  return 1;
+}
+
+/**
+ *  \brief Turn the whole request at the start of the bytes of a connection into jobs.
+ *
+ *  The request takes over the buffer of the connection, the bytes after it are moved to a new one.
+ *
+ *  \param conn connection.
+ *  \param used length of the request.
+ *  \param n number of items.
+ *  \param jobs where the jobs are added.
+ *  \param num_jobs number of jobs in jobs, updated.
+ *  \param jobs_cap size of jobs, updated.
+ *  \return request, or NULL if out of memory.
+ */
+
+static ServiceRequest *build_request(Connection *conn, size_t used, int n, ServiceJob **jobs, long *num_jobs,
+                                     long *jobs_cap) {
+  ServiceRequest *req = calloc(1, sizeof(ServiceRequest));
+  size_t cap = (conn->len - used > CONN_BUFFER) ? conn->len - used : CONN_BUFFER;
+  unsigned char *p, *nl, *rest;
+  struct stat st;
+
+  if (req == NULL || (req->items = calloc(n, sizeof(struct ServiceItem))) == NULL
+      || (rest = malloc(cap)) == NULL) {                        /* the connection keeps its buffer */
+    if (req != NULL)
+      free(req->items);
+    free(req);
+    return NULL;
+  }
+
+  req->conn = conn;
+  req->buf = conn->buf;
+  req->num_items = n;
+  req->pending = 1;
+
+  conn->cap = cap;
+  conn->buf = rest;
+  memcpy(conn->buf, req->buf + used, conn->len - used);
+  conn->len -= used;
+
+  p = (unsigned char *)memchr(req->buf, '\n', used) + 1;
+  for (int i = 0; i < n; i++) {
+    struct ServiceItem *it = &req->items[i];
+
+    nl = memchr(p, '\n', used - (p - req->buf));
+    *nl = '\0';
+    it->req = req;
+
+    if (p[0] == 'F') {                                                                       /* FILE <path> */
+      it->path = (const char *)p + 5;
+      p = nl + 1;
+      if (stat(it->path, &st) != 0)
+        it->err = errno;
+      else if (!S_ISREG(st.st_mode))
+        it->err = ERR_NOT_REGULAR;
+      else if (st.st_size > CHUNK_SIZE) {                           /* its chunks share a mapping */
+        if (!map_file(it->path, &it->map))
+          it->err = errno ? errno : EIO;
+        else {
+          it->mapped = 1;
+          it->data = it->map.data;
+          it->size = it->map.size;
+        }
+      }
+    }
+    else {                                                                             /* DATA <size> */
+      it->size = strtoull((const char *)p + 5, NULL, 10);
+      it->data = nl + 1;
+      p = nl + 1 + it->size;
+    }
+
+    if (it->err != 0)
+      continue;
+
+    it->num_chunks = (it->size > CHUNK_SIZE) ? (int)((it->size + CHUNK_SIZE - 1) / CHUNK_SIZE) : 1;
+    it->chunks_left = it->num_chunks;
+    if (it->num_chunks > 1
+        && posix_memalign((void **)&it->res, CACHE_LINE, it->num_chunks * sizeof(ChunkResult)) != 0) {
+      it->res = NULL;
+      it->err = ENOMEM;
+      continue;
+    }
+
+    if (*num_jobs + it->num_chunks > *jobs_cap) {
+      long cap = *jobs_cap;
+      ServiceJob *grown;
+
+      while (*num_jobs + it->num_chunks > cap)
+        cap *= 2;
+      if ((grown = realloc(*jobs, cap * sizeof(ServiceJob))) == NULL) {
+        it->err = ENOMEM;
+        continue;
+      }
+      *jobs = grown;
+      *jobs_cap = cap;
+    }
+    for (int c = 0; c < it->num_chunks; c++) {
+      (*jobs)[*num_jobs].item = it;
+      (*jobs)[*num_jobs].chunk = c;
+      (*num_jobs)++;
+    }
+    req->pending++;
+  }
+
+  return req;
+}
+
+/**
+ *  \brief Close a connection and drop it from the list.
+ *
+ *  \param k position of the connection in the list.
+ */
+
+static void close_conn(int k) {
+  close(conns[k]->fd);
+  free(conns[k]->buf);
+  free(conns[k]);
+  conns[k] = conns[--num_conns];
+}
+
+/**
+ *  \brief Accept the pending connections.
+ */
+
+static void accept_conns(void) {
+  Connection *conn, **grown;
+  int fd;
+
+  while ((fd = accept(listen_fd, NULL, NULL)) >= 0) {
+    if ((conn = malloc(sizeof(Connection))) == NULL || (conn->buf = malloc(CONN_BUFFER)) == NULL) {
+      perror("error on accepting a connection");
+      free(conn);
+      close(fd);
+      continue;
+    }
+    conn->fd = fd;
+    conn->len = 0;
+    conn->cap = CONN_BUFFER;
+    conn->busy = 0;
+
+    if ((grown = realloc(conns, (num_conns + 1) * sizeof(Connection *))) == NULL) {
+      perror("error on accepting a connection");
+      free(conn->buf);
+      free(conn);
+      close(fd);
+      continue;
+    }
+    conns = grown;
+    conns[num_conns++] = conn;
+  }
+
+  if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+    perror("error on accepting a connection");
+}
+
+/**
+ *  \brief Read what a connection sent.
+ *
+ *  \param conn connection.
+ *  \return 0 if the connection was closed by the client or failed, 1 otherwise.
+ */
+
+static int read_conn(Connection *conn) {
+  ssize_t n;
+
+  if (conn->cap - conn->len < CONN_BUFFER / 2) {
+    unsigned char *grown = realloc(conn->buf, conn->cap * 2);
+
+    if (grown == NULL)
+      return 0;
+    conn->buf = grown;
+    conn->cap *= 2;
+  }
+
+  if ((n = read(conn->fd, conn->buf + conn->len, conn->cap - conn->len)) < 0)
+    return errno == EINTR;
+  conn->len += n;
+
+  return n > 0;
+}
+
+/**
+ *  \brief Accept requests until the service is stopped by a signal.
+ *
+ *  Operation carried out by the main thread, once the workers are created. Returns after telling the
+ *  workers to terminate.
+ */
+
+void serve_requests(void) {
+  struct pollfd *fds = NULL;
+  Connection **polled = NULL;
+  ServiceRequest **built = NULL;
+  ServiceJob *jobs;
+  long num_jobs, jobs_cap = 1024;
+  int nfds, num_built, r, items;
+  size_t used;
+  char drain[256];
+
+  jobs = malloc(jobs_cap * sizeof(ServiceJob));
+
+  while (!stop_requested) {
+    fds = realloc(fds, (num_conns + 2) * sizeof(struct pollfd));
+    polled = realloc(polled, (num_conns + 1) * sizeof(Connection *));
+    fds[0].fd = listen_fd;
+    fds[0].events = POLLIN;
+    fds[1].fd = wake_pipe[0];
+    fds[1].events = POLLIN;
+    nfds = 2;
+
+    /* a connection with a request being counted is not read */
+    for (int k = 0; k < num_conns; k++)
+      if (!__atomic_load_n(&conns[k]->busy, __ATOMIC_ACQUIRE)) {
+        polled[nfds - 2] = conns[k];
+        fds[nfds].fd = conns[k]->fd;
+        fds[nfds].events = POLLIN;
+        nfds++;
+      }
+
+    if (ppoll(fds, nfds, NULL, &poll_mask) < 0) {
+      if (errno == EINTR)
+        continue;
+      perror("error on polling");
+      break;
+    }
+
+    if (fds[1].revents & POLLIN)
+      while (read(wake_pipe[0], drain, sizeof(drain)) > 0)
+        ;
+
+    for (int f = 2; f < nfds; f++)
+      if ((fds[f].revents & (POLLIN | POLLHUP | POLLERR)) && !read_conn(polled[f - 2]))
+        for (int k = 0; k < num_conns; k++)
+          if (conns[k] == polled[f - 2]) {
+            close_conn(k);
+            break;
+          }
+
+    if (fds[0].revents & POLLIN)
+      accept_conns();
+
+    /* the requests completed in this round are queued together */
+    num_jobs = 0;
+    num_built = 0;
+    built = realloc(built, (num_conns + 1) * sizeof(ServiceRequest *));
+    for (int k = 0; k < num_conns; k++) {
+      Connection *conn = conns[k];
+
+      if (conn->len == 0 || __atomic_load_n(&conn->busy, __ATOMIC_ACQUIRE))
+        continue;
+
+      if ((r = scan_request(conn->buf, conn->len, &used, &items)) == 0 && conn->len <= SERVICE_MAX_REQUEST)
+        continue;
+
+      if (r <= 0) {
+        if (send(conn->fd, "ERR malformed request\n", 22, MSG_NOSIGNAL) < 0)
+          perror("error on answering a request");
+        close_conn(k--);
+        continue;
+      }
+
+      conn->busy = 1;
+      if ((built[num_built] = build_request(conn, used, items, &jobs, &num_jobs, &jobs_cap)) == NULL) {
+        perror("error on allocating a request");
+        close_conn(k--);
+        continue;
+      }
+      num_built++;
+    }
+
+    queue_jobs(jobs, num_jobs);
+
+    /* every job is queued, the requests can now be answered by their last job */
+    for (int b = 0; b < num_built; b++)
+      item_done(built[b]);
+  }
+
+  free(jobs);
+  free(built);
+  free(polled);
+  free(fds);
+
+  /* the workers count what is queued and terminate */
+  pthread_mutex_lock(&queue_access);
+  stopping = 1;
+  pthread_cond_broadcast(&job_ready);
+  pthread_mutex_unlock(&queue_access);
+}
+
+/**
+ *  \brief Print the requests and items served.
+ *
+ *  Operation carried out by the main thread, after the workers have terminated.
+ */
+
+void print_service_stats(void) {
+  printf("Service: %ld requests, %ld items\n", requests_served, items_served);
+}
+
+/**
+ *  \brief Close the socket of the service.
+ *
+ *  Operation carried out by the main thread, after the workers have terminated.
+ */
+
+void free_service(void) {
+  while (num_conns > 0)
+    close_conn(num_conns - 1);
+  free(conns);
+
+  close(listen_fd);
+  close(wake_pipe[0]);
+  close(wake_pipe[1]);
+  unlink(socket_path);
+
+  pthread_cond_destroy(&job_ready);
+  free(queue);
+}
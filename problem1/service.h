@@ -0,0 +1,54 @@
+/**
+ *  \file service.h (interface file)
+ *
+ *  \brief Problem name: Total number of words, number of words beginning with a vowel and ending with a consonant.
+ *
+ *  Resident service.
+ *  The workers are created once and wait for jobs; the main thread accepts requests on a Unix domain socket,
+ *  each a list of file paths or inline buffers, queues their counting on the workers and the results are sent
+ *  back on the same connection.
+ *
+ *  Definition of the operations carried out by the workers:
+ *     \li get_service_job
+ *     \li run_service_job.
+ *
+ *  Definition of the operations carried out by the main thread:
+ *     \li init_service
+ *     \li serve_requests
+ *     \li print_service_stats
+ *     \li free_service.
+ *
+ *  \author Eduardo Santos and Pedro Bastos - April 2022
+ */
+
+#ifndef SERVICE_H_
+#define SERVICE_H_
+
+/** \brief an item of a request being counted */
+struct ServiceItem;
+
+/** \brief a job of the workers: a whole item, or a chunk of a large one */
+typedef struct {
+  struct ServiceItem *item;                                                                    /* item */
+  int chunk;                                                                         /* chunk of the item */
+} ServiceJob;
+
+/** \brief Create the socket of the service and the queue of jobs. */
+extern int init_service(const char *path);
+
+/** \brief Accept requests until the service is stopped by a signal. */
+extern void serve_requests(void);
+
+/** \brief Take the next job, waiting for one. */
+extern int get_service_job(unsigned int id, ServiceJob *job);
+
+/** \brief Count a job and answer its request if it was the last one. */
+extern void run_service_job(unsigned int id, const ServiceJob *job);
+
+/** \brief Print the requests and items served. */
+extern void print_service_stats(void);
+
+/** \brief Close the socket of the service. */
+extern void free_service(void);
+
+#endif /* SERVICE_H_ */
@@ -16,7 +16,12 @@
  *     \li save_file_results.
  * 
  *  Definition of the operations carried out by the main thread:
- *     \li print_final_results.
+ *     \li print_final_results
+ *     \li print_monitor_stats.
+ *
+ *  Compiling with -DMONITOR_STATS makes every worker count, in counters of its own, how often and how long it
+ *  waits for the monitor lock, how long it waits on the conditions and how many bytes and reads it processes.
+ *  Without it the accounting is compiled out.
  *
  *  \author Eduardo Santos and Pedro Bastos - April 2022
  */
@@ -28,14 +33,40 @@
 #include <pthread.h>
 #include <errno.h>
 #include <math.h>
+#include <time.h>
 
 #include "probConst.h"
+#include "wordCount.h"
+#include "utf8.h"
+#include "fileReader.h"
+#include "ioEngine.h"
+#include "resumeState.h"
+#include "textStats.h"
+#include "wordFreq.h"
+
+/** \brief number of workers */
+extern unsigned int num_workers;
 
 /** \brief worker threads return status array */
-extern int statusCons[N];
+extern int *statusCons;
+
+/** \brief array to flag the workers that met a file they could not open */
+extern int *worker_failed;
+
+/** \brief contents of the current file, mapped in memory */
+static MappedFile file_map;
+
+/** \brief position of the next char to read in the current file */
+static const unsigned char *file_pos;
+
+/** \brief offset the current file is counted from, past the bytes counted by an earlier run */
+static size_t file_start;
+
+/** \brief words counted by an earlier run, before file_start */
+static long file_start_words;
 
-/** \brief pointer to the file */
-FILE *fp;
+/** \brief end of the bytes of the current file to read */
+static const unsigned char *file_end;
 
 /** \brief array of the filenames retrieved from the main file */
 extern char **filenames;
@@ -44,13 +75,28 @@ extern char **filenames;
 extern int num_files;
 
 /** \brief array to save the total number of words for each file */
-extern int *array_num_words;
+extern long *array_num_words;
 
 /** \brief array to save the number of words beginning with a vowel for each file */
-extern int *array_num_vowels;
+extern long *array_num_vowels;
 
 /** \brief array to save the number of words ending with a consonant for each file */
-extern int *array_num_cons;
+extern long *array_num_cons;
+
+/** \brief array to save the number of bytes read from each file */
+extern long *array_num_bytes;
+
+/** \brief array to save the number of words counted from the bytes read from each file in this run */
+extern long *array_run_words;
+
+/** \brief array to flag the files that could not be read to their end, whose counts are partial */
+extern int *array_incomplete;
+
+/** \brief array to save the extended statistics of each file, NULL when they are off */
+extern TextStats *array_text_stats;
+
+/** \brief number of most frequent words reported, 0 when they are off */
+extern int top_words;
 
 /** \brief Size of the chunk to read */
 int num_bytes = 10;
@@ -82,23 +128,63 @@ int open_file = 0;
 /** \brief flag that indicates if the file was already closed */
 int close_file = 0;
 
-/** \brief variable to save the number of words beginning with a vowel for each file */
-int num_vowels = 0;
-
-/** \brief variable to save the number of words ending with a consonant for each file */
-int num_cons = 0;
-
-/** \brief variable to save the total number of words for each file */
-int total_num_words = 1;
+/** \brief counting state of the current file (number of words, of words beginning with a vowel and of words
+ *  ending with a consonant, plus the previous char) */
+static CountState file_state = { 0, 0, 0, 0, 1 };
 
-/** \brief variables used in the computation of each file */
-int value_before = 0;
-int end_of_word = 0;
-int flag = 0;
+/** \brief word of the current file being read, for the most frequent words */
+static WordToken file_token;
 
 /** \brief flag that indicates the partial results are being saved */
 int partial_results = 0;
 
+#ifdef MONITOR_STATS
+
+/** \brief accounting of a worker, on cache lines of its own */
+typedef struct {
+  long lock_acquisitions;                                                   /* times the monitor was entered */
+  long lock_wait_ns;                                                       /* time waiting for the monitor lock */
+  long cond_wait_ns;                                                          /* time waiting on the conditions */
+  long bytes;                                                                              /* bytes decoded */
+  long reads;                                                                      /* calls of getVal that read */
+} __attribute__((aligned(CACHE_LINE))) WorkerStats;
+
+/** \brief accounting of each worker */
+static WorkerStats *worker_stats;
+
+/** \brief flag which warrants that the accounting is allocated exactly once */
+static pthread_once_t stats_init = PTHREAD_ONCE_INIT;
+
+/** \brief Allocate the accounting of the workers. */
+static void alloc_stats(void) {
+  if (posix_memalign((void **)&worker_stats, CACHE_LINE, num_workers * sizeof(WorkerStats)) != 0) {
+    perror("error on allocating the monitor accounting");
+    exit(EXIT_FAILURE);
+  }
+  for (int i = 0; i < num_workers; i++)
+    worker_stats[i] = (WorkerStats){ 0, 0, 0, 0, 0 };
+}
+
+/** \brief Current time in nanoseconds. */
+static inline long stats_now(void) {
+  struct timespec t;
+
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec * 1000000000L + t.tv_nsec;
+}
+
+#define STATS_START(t)       pthread_once(&stats_init, alloc_stats); long t = stats_now()
+#define STATS_LOCKED(id, t)  (worker_stats[id].lock_acquisitions++, worker_stats[id].lock_wait_ns += stats_now() - (t))
+#define STATS_WAITED(id, t)  (worker_stats[id].cond_wait_ns += stats_now() - (t))
+
+#else
+
+#define STATS_START(t)
+#define STATS_LOCKED(id, t)
+#define STATS_WAITED(id, t)
+
+#endif /* MONITOR_STATS */
+
 /** 
  *  \brief Initialize the needed conditions.
  *  
@@ -121,12 +207,14 @@ static void initialization(void) {
 
 int check_for_file(unsigned int id) {
 
+  STATS_START(lock_start);
   if ((statusCons[id] = pthread_mutex_lock(&vars_access)) != 0) {                                                     /* enter monitor */
     errno = statusCons[id];                                                                                     /* save error in errno */
     perror("error on entering monitor(CF)");
     statusCons[id] = EXIT_FAILURE;
     pthread_exit(&statusCons[id]);
   }
+  STATS_LOCKED(id, lock_start);
 
   pthread_once(&init, initialization);
 
@@ -135,7 +223,8 @@ int check_for_file(unsigned int id) {
 
   int flag_file = 1;
 
-  while (wait_for_read != N) {                                                               /* Wait while there are workers not ready */
+  STATS_START(wait_start);
+  while (wait_for_read != num_workers) {                                                               /* Wait while there are workers not ready */
     if ((statusCons[id] = pthread_cond_wait(&wait_file_open, &vars_access)) != 0){
       errno = statusCons[id];                                                       
       perror("error on waiting condition to open file");
@@ -143,13 +232,26 @@ int check_for_file(unsigned int id) {
       pthread_exit(&statusCons[id]);
     }
   }
+  STATS_WAITED(id, wait_start);
 
   if (index_file < num_files) {                                                          /* Check if there are more files to be opened */
     if (!open_file) {                                            /* Check if the file is not already being opened and, if not, open it */
       open_file = 1;
       close_file = 0;
       end_of_file = 0;
-      fp = fopen(filenames[index_file], "r");
+      if (!io_open_file(index_file, &file_map)) {                  /* reported, not taken for an empty file */
+        perror("error on opening file");
+        array_incomplete[index_file] = 1;
+        worker_failed[id] = 1;
+        file_map.data = NULL;
+        file_map.size = 0;
+        file_map.mapped = 0;
+      }
+      file_start = get_resume_point(index_file, file_map.size, &file_state);
+      file_start_words = file_state.total_num_words;
+      file_token.len = file_token.cut = 0;
+      file_pos = file_map.data + file_start;
+      file_end = file_map.data + resume_limit(file_map.data, file_map.size);
     }
   }
 
@@ -183,17 +285,20 @@ int check_for_file(unsigned int id) {
  */
 
 void check_close_file(unsigned int id) {
+  STATS_START(lock_start);
   if ((statusCons[id] = pthread_mutex_lock(&vars_access)) != 0) {                                                     /* enter monitor */
     errno = statusCons[id];                                                                                     /* save error in errno */
     perror("error on entering monitor(CF)");
     statusCons[id] = EXIT_FAILURE;
     pthread_exit(&statusCons[id]);
   }
+  STATS_LOCKED(id, lock_start);
 
   /* Increment number of workers ready */
   end_of_file++;
 
-  while (end_of_file != N) {                                                                 /* Wait while there are workers not ready */
+  STATS_START(wait_start);
+  while (end_of_file != num_workers) {                                                                 /* Wait while there are workers not ready */
     if ((statusCons[id] = pthread_cond_wait(&wait_file_close, &vars_access)) != 0) {
       errno = statusCons[id]; 
       perror("error on waiting condition to close file");
@@ -201,16 +306,15 @@ void check_close_file(unsigned int id) {
       pthread_exit(&statusCons[id]);
     }
   }
+  STATS_WAITED(id, wait_start);
 
   if (!close_file) {                                            /* Check if the file is not already being closed and, if not, close it */
-    fclose(fp);
+    io_close_file(index_file, &file_map);
     index_file++;
     open_file = 0;
     close_file = 1;
     wait_for_read = 0;
-    total_num_words = 0;
-    num_vowels = 0;
-    num_cons = 0;
+    init_count_state(&file_state);
     partial_results = 0;
   }
 
@@ -229,123 +333,23 @@ void check_close_file(unsigned int id) {
   }
 }
 
-/** 
- *  \brief Calculate the next char and convert it to integer.
- *  
- *  Operation carried out by the workers.
- * 
- *  \param fp pointer to file.
- *  \return value.
- */
-
-int get_int(FILE *fp) {
-
-  int ch_value = fgetc(fp);
-  int b = 0;
-
-  if (ch_value == -1) /* if EOF */
-    return -1;
-
-  if ((ch_value & 128) == 0) { /* if is only 1 byte char, return it */
-    return ch_value;
-  }
-
-  /* if contains 226 ('e2'), then it is a 3 byte char */
-  if (ch_value == 226) { 
-    b = 3;
-    ch_value = ch_value & (1 << 4) - 1;
-  }
-
-  /* else, is a 2 byte char */
-  else {
-    b = 2;
-    ch_value = ch_value & (1 << 5) - 1;
-  }
-
-  /* go through number of the char bytes */
-  for (int x = 1; x < b; x++) {
-
-    /* get next byte */
-    int next_ch_value = fgetc(fp);
-
-    /* if EOF */
-    if (next_ch_value == -1)
-      return -1;
-
-    /* calculate int value of the char */
-    ch_value = (ch_value << 6) | (next_ch_value & 63);
-  }
-
-  return ch_value;
-}
-
-/** 
- *  \brief Check if a given char is a vowel.
- *  
- *  Operation carried out by the workers.
- * 
- *  \param char_value character value to be checked.
- *  \return 1 if is a vowel, 0 otherwise.
- */
-
-int is_vowel(int char_value) {
-  /* list of all the vowels values */
-  int vowels[] = {97, 101, 105, 111, 117, 65, 69, 73, 79, 85, 224, 225, 226, 227, 232, 233, 234, 236, 237, 238,
-                  242, 243, 244, 245, 249, 250, 192, 193, 194, 195, 200, 201, 202, 204, 205, 206, 210,
-                  211, 212, 213, 217, 218, 219, 251};
-
-  /* go through the list and check if it contains the given char */
-  for (int i = 0; i < sizeof(vowels) / sizeof(vowels[0]); i++)
-    if (vowels[i] == char_value) {
-      return 1;
-    }
-
-  return 0;
-}
-
-/** 
- *  \brief Check if a given char is a consonant.
- *  
- *  Operation carried out by the workers.
- * 
- *  \param char_value character value to be checked.
- *  \return 1 if is a consonant, 0 otherwise.
- */
-
-int is_consonant(int char_value) {
-  /* list of all the consonants values */
-  int consonants[] = {98, 99, 100, 102, 103, 104, 106, 107, 108, 109, 110, 112, 113, 114, 115, 116, 118, 119, 120, 121, 122,
-                      66, 67, 68, 70, 71, 72, 74, 75, 76, 77, 78, 80, 81, 82, 83, 84, 86, 87, 88, 89, 90,
-                      231, 199};
-
-  /* go through the list and check if it contains the given char */
-  for (int i = 0; i < sizeof(consonants) / sizeof(consonants[0]); i++)
-    if (consonants[i] == char_value)
-      return 1;
-
-  return 0;
-}
-
-/** 
- *  \brief Check if a given char is a split.
- *  
- *  Operation carried out by the workers.
- * 
- *  \param char_value character value to be checked.
- *  \return 1 if is a split, 0 otherwise.
+/**
+ *  \brief Account for a char of the current file, in the counts and in what else was asked for.
+ *
+ *  Called inside the monitor.
+ *
+ *  \param id worker identification.
+ *  \param ch_value value of the char.
  */
 
-int is_split(int char_value) {
-  /* list of all the split char values */
-  int splits[] = {32, 9, 10, 45, 34, 8220, 8221, 91, 93, 123, 125, 40, 41, 46, 44,
-                  58, 59, 63, 33, 8211, 8212, 8230, 171, 187, 96};
-
-  /* go through the list and check if it contains the given char */
-  for (int i = 0; i < sizeof(splits) / sizeof(splits[0]); i++)
-    if (splits[i] == char_value)
-      return 1;
+static void account_char(unsigned int id, int ch_value) {
+  if (top_words > 0)
+    word_char(id, index_file, &file_token, &file_state, ch_value);
 
-  return 0;
+  if (array_text_stats != NULL)
+    count_char_stats(&file_state, &array_text_stats[index_file], ch_value);
+  else
+    count_char(&file_state, ch_value);
 }
 
 /**
@@ -359,22 +363,28 @@ int is_split(int char_value) {
 
 unsigned int getVal(unsigned int consId) {
 
+  STATS_START(lock_start);
   if ((statusCons[consId] = pthread_mutex_lock(&vars_access)) != 0) {                                                 /* enter monitor */
     errno = statusCons[consId];                                                                                 /* save error in errno */
     perror("error on entering monitor(CF)");
     statusCons[consId] = EXIT_FAILURE;
     pthread_exit(&statusCons[consId]);
   }
+  STATS_LOCKED(consId, lock_start);
 
   pthread_once(&init, initialization); 
 
   /* flag to indicate if the file is over */
   int flag_file_over = 0;
 
+#ifdef MONITOR_STATS
+  const unsigned char *read_start = file_pos;
+#endif
+
   for (int counter = 0; counter < num_bytes; counter++) {                                          /* read a specified number of bytes */ 
 
     /* get next char value */
-    int ch_value = get_int(fp);
+    int ch_value = get_int_buf(&file_pos, file_end);
 
     /* if EOF */
     if (ch_value == -1) {
@@ -382,48 +392,16 @@ unsigned int getVal(unsigned int consId) {
       break;
     }
 
-    /* check if first char of file is vowel */
-    if (flag == 0) {
-      if (is_vowel(ch_value) == 1) {
-        num_vowels += 1;
-      }
-      flag = 1;
-    }
-
-    /* check if is a lonely apostrophe to avoid counting as word */
-    if (ch_value == 39 || ch_value == 8216 || ch_value == 8217) {
-      if (is_split(value_before))
-        continue;
-    }
-
-    /* if is split char */
-    if (is_split(ch_value)) {
-
-      /* check if previous char was a consonant */
-      if (is_consonant(value_before))
-        num_cons += 1;
-
-      end_of_word = 1;
-    }
-
-    /* not a split chat */
-    else{
-      /* check if is end of word to sum total words */
-      if (end_of_word == 1) {
-
-        total_num_words += 1;
-        end_of_word = 0;
-
-        /* if first char of new word is vowel */
-        if (is_vowel(ch_value) == 1)
-          num_vowels += 1;
-      }
-    }
-
-    /* save previous char to check in next iteration */
-    value_before = ch_value;
+    /* account for the char, carrying the state of the file */
+    account_char(consId, ch_value);
   }
 
+#ifdef MONITOR_STATS
+  worker_stats[consId].bytes += file_pos - read_start;
+  if (file_pos != read_start)
+    worker_stats[consId].reads++;
+#endif
+
   if ((statusCons[consId] = pthread_mutex_unlock(&vars_access)) != 0) {                                                /* exit monitor */
     errno = statusCons[consId];                                                                                 /* save error in errno */
     perror("error on exiting monitor(CF)");
@@ -446,19 +424,37 @@ unsigned int getVal(unsigned int consId) {
  *  \param consId worker identification.
  */
 
-void save_file_results(consId) {
+void save_file_results(unsigned int consId) {
+  STATS_START(lock_start);
   if ((statusCons[consId] = pthread_mutex_lock(&vars_access)) != 0) {                                                 /* enter monitor */
     errno = statusCons[consId];                                                                                 /* save error in errno */
     perror("error on entering monitor(CF)");
     statusCons[consId] = EXIT_FAILURE;
     pthread_exit(&statusCons[consId]);
   }
+  STATS_LOCKED(consId, lock_start);
 
   /* Ensure that only 1 worker saves the file results */
   if (!partial_results) {
-    array_num_words[index_file] = total_num_words;
-    array_num_vowels[index_file] = num_vowels;
-    array_num_cons[index_file] = num_cons;
+    set_resume_point(index_file, file_map.data, file_end - file_map.data, &file_state);
+
+    /* a sequence cut by the end of the file, left out of the resume point */
+    const unsigned char *tail = file_end;
+    int ch_value;
+
+    while ((ch_value = get_int_buf(&tail, file_map.data + file_map.size)) != -1)
+      account_char(consId, ch_value);
+
+    if (array_text_stats != NULL)
+      finish_text_stats(&file_state, &array_text_stats[index_file]);
+    if (top_words > 0)
+      finish_word(index_file, &file_state, &file_token);
+
+    array_num_words[index_file] = file_state.total_num_words;
+    array_num_vowels[index_file] = file_state.num_vowels;
+    array_num_cons[index_file] = file_state.num_cons;
+    array_num_bytes[index_file] = file_map.size - file_start;
+    array_run_words[index_file] = file_state.total_num_words - file_start_words;
     partial_results = 1;
   }
 
@@ -479,8 +475,35 @@ void save_file_results(consId) {
 void print_final_results() {
   for (int i = 0; i < num_files; i++) {
     printf("File name: %s \n", filenames[i]);
-    printf("Total number of words = %d \n", array_num_words[i]);
-    printf("N. of words beginning with a vowel = %d \n", array_num_vowels[i]);
-    printf("N. of words ending with a consonant = %d \n\n", array_num_cons[i]);
+    printf("Total number of words = %ld \n", array_num_words[i]);
+    printf("N. of words beginning with a vowel = %ld \n", array_num_vowels[i]);
+    printf("N. of words ending with a consonant = %ld \n", array_num_cons[i]);
+    if (array_incomplete[i])
+      printf("Incomplete: the file could not be read to its end, the counts cover the bytes read \n");
+    printf("\n");
   }
 }
+
+/**
+ *  \brief Print the lock and condition waits and the work of each worker.
+ *
+ *  Operation carried out by the main thread, after the workers have terminated. Prints nothing unless the
+ *  accounting was compiled in with -DMONITOR_STATS.
+ */
+
+void print_monitor_stats(void) {
+#ifdef MONITOR_STATS
+  if (worker_stats == NULL)
+    return;
+
+  printf("Monitor contention:\n");
+  printf("%6s %12s %14s %14s %12s %10s\n", "worker", "locks", "lock wait (s)", "cond wait (s)", "bytes", "reads");
+  for (int i = 0; i < num_workers; i++)
+    printf("%6d %12ld %14.6f %14.6f %12ld %10ld\n", i, worker_stats[i].lock_acquisitions,
+           worker_stats[i].lock_wait_ns / 1000000000.0, worker_stats[i].cond_wait_ns / 1000000000.0,
+           worker_stats[i].bytes, worker_stats[i].reads);
+
+  free(worker_stats);
+  worker_stats = NULL;
+#endif
+}
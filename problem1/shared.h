@@ -16,7 +16,8 @@
  *     \li save_file_results.
  * 
  *  Definition of the operations carried out by the main thread:
- *     \li print_final_results.
+ *     \li print_final_results
+ *     \li print_monitor_stats.
  *
  *  \author Eduardo Santos and Pedro Bastos - April 2022
  */
@@ -37,6 +38,9 @@ extern void save_file_results(unsigned int consId);
 /** \brief Print final results. */
 extern void print_final_results();
 
+/** \brief Print the lock and condition waits and the work of each worker. */
+extern void print_monitor_stats(void);
+
 
 
 
@@ -0,0 +1,213 @@
+/**
+ *  \file simdCount.c (implementation file)
+ *
+ *  \brief Problem name: Total number of words, number of words beginning with a vowel and ending with a consonant.
+ *
+ *  SIMD fast path for plain ASCII text.
+ *  Blocks of 32 bytes are classified at once (AVX2, or two SSE2 halves) into bit masks, bit i standing for
+ *  byte i, and the words are counted with shifts and popcounts; a block holding a byte with the high bit set
+ *  is left to the scalar UTF-8 path. The kernel is chosen once from the CPU features; without one, or when
+ *  compiled with -DNO_SIMD, every byte goes through the scalar path.
+ *
+ *  The rules are the ones of count_char:
+ *     \li an apostrophe is skipped when the last char not skipped is a split, which extends to a run of them;
+ *     \li a word starts at a char that is neither a split nor skipped, after a split or a skipped apostrophe;
+ *     \li a word ends with a consonant when a split comes right after a consonant.
+ *
+ *  Definition of the operations carried out by the workers:
+ *     \li count_ascii
+ *     \li simd_kernel_name.
+ *
+ *  \author Eduardo Santos and Pedro Bastos - April 2022
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && !defined(NO_SIMD)
+#include <immintrin.h>
+#define HAVE_X86_SIMD
+#endif
+
+#include "simdCount.h"
+
+/** \brief class masks of a block, bit i for byte i */
+typedef struct {
+  uint32_t split;
+  uint32_t apostrophe;
+  uint32_t vowel;
+  uint32_t consonant;
+  uint32_t high;                                                               /* bytes of UTF-8 sequences */
+} BlockMasks;
+
+/** \brief classifier of a block of SIMD_BLOCK bytes */
+typedef void (*classify_fn)(const unsigned char *block, BlockMasks *masks);
+
+/** \brief selected classifier, NULL when only the scalar path is available */
+static classify_fn classify_block = NULL;
+
+/** \brief name of the selected kernel */
+static const char *kernel_name = "scalar";
+
+/** \brief flag which warrants that the kernel is selected exactly once */
+static pthread_once_t init = PTHREAD_ONCE_INIT;
+
+#ifdef HAVE_X86_SIMD
+
+/** \brief ASCII chars of latin1_class marked as CHAR_SPLIT */
+static const char ascii_splits[] = "\t\n !\"(),-.:;?[]`{}";
+
+/** \brief ASCII chars of latin1_class marked as CHAR_VOWEL, in lower case */
+static const char ascii_vowels[] = "aeiou";
+
+/**
+ *  \brief Classify a block with two SSE2 vectors.
+ *
+ *  \param block first byte of the block.
+ *  \param masks where the masks are stored.
+ */
+
+__attribute__((target("sse2")))
+static void classify_sse2(const unsigned char *block, BlockMasks *masks) {
+  masks->split = masks->apostrophe = masks->vowel = masks->consonant = masks->high = 0;
+
+  for (int half = 0; half < 2; half++) {
+    __m128i x = _mm_loadu_si128((const __m128i *)(block + 16 * half));
+    __m128i lower = _mm_or_si128(x, _mm_set1_epi8(0x20));                            /* fold to lower case */
+    __m128i t = _mm_sub_epi8(lower, _mm_set1_epi8('a'));
+    __m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(t, _mm_set1_epi8(-1)), _mm_cmplt_epi8(t, _mm_set1_epi8(26)));
+    __m128i vowel = _mm_setzero_si128();
+    __m128i split = _mm_setzero_si128();
+    int shift = 16 * half;
+
+    for (int i = 0; i < sizeof(ascii_vowels) - 1; i++)
+      vowel = _mm_or_si128(vowel, _mm_cmpeq_epi8(lower, _mm_set1_epi8(ascii_vowels[i])));
+    for (int i = 0; i < sizeof(ascii_splits) - 1; i++)
+      split = _mm_or_si128(split, _mm_cmpeq_epi8(x, _mm_set1_epi8(ascii_splits[i])));
+
+    masks->split |= (uint32_t)_mm_movemask_epi8(split) << shift;
+    masks->apostrophe |= (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(x, _mm_set1_epi8('\''))) << shift;
+    masks->vowel |= (uint32_t)_mm_movemask_epi8(vowel) << shift;
+    masks->consonant |= (uint32_t)_mm_movemask_epi8(_mm_andnot_si128(vowel, alpha)) << shift;
+    masks->high |= (uint32_t)_mm_movemask_epi8(x) << shift;
+  }
+}
+
+/**
+ *  \brief Classify a block with one AVX2 vector.
+ *
+ *  \param block first byte of the block.
+ *  \param masks where the masks are stored.
+ */
+
+__attribute__((target("avx2")))
+static void classify_avx2(const unsigned char *block, BlockMasks *masks) {
+  __m256i x = _mm256_loadu_si256((const __m256i *)block);
+  __m256i lower = _mm256_or_si256(x, _mm256_set1_epi8(0x20));                         /* fold to lower case */
+  __m256i t = _mm256_sub_epi8(lower, _mm256_set1_epi8('a'));
+  __m256i alpha = _mm256_and_si256(_mm256_cmpgt_epi8(t, _mm256_set1_epi8(-1)),
+                                   _mm256_cmpgt_epi8(_mm256_set1_epi8(26), t));
+  __m256i vowel = _mm256_setzero_si256();
+  __m256i split = _mm256_setzero_si256();
+
+  for (int i = 0; i < sizeof(ascii_vowels) - 1; i++)
+    vowel = _mm256_or_si256(vowel, _mm256_cmpeq_epi8(lower, _mm256_set1_epi8(ascii_vowels[i])));
+  for (int i = 0; i < sizeof(ascii_splits) - 1; i++)
+    split = _mm256_or_si256(split, _mm256_cmpeq_epi8(x, _mm256_set1_epi8(ascii_splits[i])));
+
+  masks->split = (uint32_t)_mm256_movemask_epi8(split);
+  masks->apostrophe = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('\'')));
+  masks->vowel = (uint32_t)_mm256_movemask_epi8(vowel);
+  masks->consonant = (uint32_t)_mm256_movemask_epi8(_mm256_andnot_si256(vowel, alpha));
+  masks->high = (uint32_t)_mm256_movemask_epi8(x);
+}
+
+#endif /* HAVE_X86_SIMD */
+
+/**
+ *  \brief Select the kernel supported by the CPU.
+ */
+
+static void initialization(void) {
+#ifdef HAVE_X86_SIMD
+  __builtin_cpu_init();
+
+  if (__builtin_cpu_supports("avx2")) {
+    classify_block = classify_avx2;
+    kernel_name = "avx2";
+  }
+  else if (__builtin_cpu_supports("sse2")) {
+    classify_block = classify_sse2;
+    kernel_name = "sse2";
+  }
+#endif
+}
+
+/**
+ *  \brief Count the leading ASCII blocks of a buffer.
+ *
+ *  Operation carried out by the workers. Stops at the end of the last whole block or before the first block
+ *  holding a non-ASCII byte, whichever comes first; the caller continues from there with the scalar path.
+ *
+ *  \param state counting state, updated as count_char would.
+ *  \param pos first byte, which must start an UTF-8 sequence.
+ *  \param end end of the buffer.
+ *  \return position of the first byte not counted.
+ */
+
+const unsigned char *count_ascii(CountState *state, const unsigned char *pos, const unsigned char *end) {
+  BlockMasks m;
+
+  pthread_once(&init, initialization);
+
+  if (classify_block == NULL)
+    return pos;
+
+  while (end - pos >= SIMD_BLOCK) {
+    classify_block(pos, &m);
+    if (m.high)                                                              /* multibyte chars, go scalar */
+      break;
+
+    unsigned char class_before = char_class(state->value_before);
+    uint64_t skip_in = (class_before & CHAR_SPLIT) != 0;
+    uint64_t cons_in = (class_before & CHAR_CONSONANT) != 0;
+    uint64_t apostrophe = m.apostrophe;
+
+    /* apostrophes right after a split, then the runs they open, found by letting a carry ripple through them */
+    uint64_t first = (((uint64_t)m.split << 1) | skip_in) & apostrophe;
+    uint64_t skipped = ((first + apostrophe) ^ apostrophe) & apostrophe;
+
+    uint64_t closed = m.split | skipped;                                       /* no word open after these */
+    uint32_t starts = (uint32_t)(~closed & ((closed << 1) | (uint64_t)state->end_of_word));
+    uint32_t ends = (uint32_t)(m.split & (((uint64_t)m.consonant << 1) | cons_in));
+
+    state->total_num_words += __builtin_popcount(starts);
+    state->num_vowels += __builtin_popcount(starts & m.vowel);
+    state->num_cons += __builtin_popcount(ends);
+
+    /* the last char not skipped becomes the previous char */
+    uint32_t kept = ~(uint32_t)skipped;
+    if (kept != 0) {
+      int last = 31 - __builtin_clz(kept);
+      state->value_before = pos[last];
+      state->end_of_word = (m.split >> last) & 1;
+    }
+
+    pos += SIMD_BLOCK;
+  }
+
+  return pos;
+}
+
+/**
+ *  \brief Name of the kernel selected for this CPU.
+ *
+ *  \return "avx2", "sse2" or "scalar".
+ */
+
+const char *simd_kernel_name(void) {
+  pthread_once(&init, initialization);
+
+  return kernel_name;
+}
@@ -0,0 +1,31 @@
+/**
+ *  \file simdCount.h (interface file)
+ *
+ *  \brief Problem name: Total number of words, number of words beginning with a vowel and ending with a consonant.
+ *
+ *  SIMD fast path for plain ASCII text.
+ *  Blocks of 32 bytes are classified at once and the words are counted with mask arithmetic; a block holding
+ *  a byte with the high bit set is left to the scalar UTF-8 path.
+ *
+ *  Definition of the operations carried out by the workers:
+ *     \li count_ascii
+ *     \li simd_kernel_name.
+ *
+ *  \author Eduardo Santos and Pedro Bastos - April 2022
+ */
+
+#ifndef SIMDCOUNT_H_
+#define SIMDCOUNT_H_
+
+#include "wordCount.h"
+
+/** \brief number of bytes handled by each step of the fast path */
+#define SIMD_BLOCK   32
+
+/** \brief Count the leading ASCII blocks of a buffer. */
+extern const unsigned char *count_ascii(CountState *state, const unsigned char *pos, const unsigned char *end);
+
+/** \brief Name of the kernel selected for this CPU. */
+extern const char *simd_kernel_name(void);
+
+#endif /* SIMDCOUNT_H_ */
@@ -0,0 +1,500 @@
+/**
+ *  \file stream.c (implementation file)
+ *
+ *  \brief Problem name: Total number of words, number of words beginning with a vowel and ending with a consonant.
+ *
+ *  Streaming mode.
+ *  The files (the standard input, compressed files, or plain files given along with them) are read by up to
+ *  STREAM_READERS reader threads into a ring of STREAM_BUFFERS_PER_WORKER buffers per worker, of
+ *  STREAM_BUFFER_SIZE bytes each, so the memory in use does not depend on the length of the files. Each reader
+ *  takes the next file not taken yet and fills buffers with its bytes, decompressed as they are read, so the
+ *  decompression of a few files runs on the readers while the workers count the buffers already filled.
+ *
+ *  The buffers are numbered in the order the readers claim them; the workers take the filled ones in turn and
+ *  count them into the result kept with each buffer. The worker that counts the oldest buffer not merged yet
+ *  merges it, and every counted buffer after it, into the state of its file and hands them back to the
+ *  readers. The buffers of a file are claimed by a single reader, so they are merged in file order even when
+ *  the buffers of several files are interleaved in the ring; the last buffer of a file, which may be empty,
+ *  stores its results in the results arrays.
+ *
+ *  A buffer never ends inside a UTF-8 sequence: the bytes of a sequence cut by the end of a read are carried
+ *  over to the start of the next buffer of the file.
+ *
+ *  Data transfer region implemented as a monitor.
+ *
+ *  Definition of the operations carried out by the readers:
+ *     \li read_stream_file.
+ *
+ *  Definition of the operations carried out by the workers:
+ *     \li get_stream_buffer
+ *     \li count_stream_buffer.
+ *
+ *  Definition of the operations carried out by the main thread:
+ *     \li init_stream
+ *     \li free_stream.
+ *
+ *  \author Eduardo Santos and Pedro Bastos - April 2022
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <errno.h>
+
+#include "probConst.h"
+#include "wordCount.h"
+#include "utf8.h"
+#include "textStats.h"
+#include "wordFreq.h"
+#include "inputSource.h"
+
+/** \brief array of the filenames retrieved from the main file */
+extern char **filenames;
+
+/** \brief variable to save the number of files */
+extern int num_files;
+
+/** \brief number of workers */
+extern unsigned int num_workers;
+
+/** \brief worker threads return status array */
+extern int *statusCons;
+
+/** \brief array to save the total number of words for each file */
+extern long *array_num_words;
+
+/** \brief array to save the number of words beginning with a vowel for each file */
+extern long *array_num_vowels;
+
+/** \brief array to save the number of words ending with a consonant for each file */
+extern long *array_num_cons;
+
+/** \brief array to save the number of bytes read from each file */
+extern long *array_num_bytes;
+
+/** \brief array to save the number of words counted from the bytes read from each file in this run */
+extern long *array_run_words;
+
+/** \brief array to flag the files that could not be read to their end, whose counts are partial */
+extern int *array_incomplete;
+
+/** \brief array to save the extended statistics of each file, NULL when they are off */
+extern TextStats *array_text_stats;
+
+/** \brief number of most frequent words reported, 0 when they are off */
+extern int top_words;
+
+/** \brief buffer states */
+#define SLOT_FREE       0                                                          /* waiting for a reader */
+#define SLOT_READING    1                                                          /* being filled by a reader */
+#define SLOT_FILLED     2                                                          /* waiting for a worker */
+#define SLOT_COUNTING   3                                                         /* being counted by a worker */
+#define SLOT_COUNTED    4                                                              /* waiting to be merged */
+
+/** \brief a buffer of the ring and the result of counting it */
+typedef struct {
+  ChunkResult res;                                                                      /* result of the buffer */
+  ChunkStats stats;                                                  /* extended statistics of the buffer */
+  WordChunk words;                                                      /* words crossing the ends of the buffer */
+  unsigned char *data;                                                                      /* bytes read */
+  size_t len;                                                                           /* number of bytes read */
+  int file_index;                                                                  /* file the bytes belong to */
+  int last;                                                                   /* 1 for the last buffer of the file */
+  int state;                                                                                 /* SLOT_* state */
+} __attribute__((aligned(CACHE_LINE))) StreamSlot;
+
+/** \brief state of a file after its merged buffers */
+typedef struct {
+  CountState state;                                                                          /* counting state */
+  TextStats stats;                                                                     /* extended statistics */
+  CountState word_state;                                                      /* state for the most frequent words */
+  WordToken token;                                                                          /* word left open */
+  long bytes;                                                                          /* bytes merged */
+} StreamFile;
+
+/** \brief ring of buffers, buffer seq is kept in slot seq % num_slots */
+static StreamSlot *ring;
+
+/** \brief number of buffers in the ring */
+static long num_slots;
+
+/** \brief state of each file, by file index */
+static StreamFile *files;
+
+/** \brief number of readers */
+static unsigned int num_readers;
+
+/** \brief next file to be taken by a reader */
+static int next_file = 0;
+
+/** \brief number of readers that found no file left */
+static unsigned int readers_done = 0;
+
+/** \brief number of buffers claimed by the readers */
+static long claimed = 0;
+
+/** \brief number of buffers taken by the workers */
+static long taken = 0;
+
+/** \brief number of buffers merged */
+static long merged = 0;
+
+/** \brief flag that indicates every file was read */
+static int end_of_stream = 0;
+
+/** \brief reader threads return status array */
+static int *status_reader;
+
+/** \brief locking flag which warrants mutual exclusion inside the monitor */
+static pthread_mutex_t ring_access = PTHREAD_MUTEX_INITIALIZER;
+
+/** \brief condition which warrants that the readers have a free buffer to fill */
+static pthread_cond_t slot_free;
+
+/** \brief condition which warrants that there is a filled buffer, or every file was read */
+static pthread_cond_t slot_filled;
+
+/**
+ *  \brief Allocate the ring of buffers and the state of the files.
+ *
+ *  Operation carried out by the main thread, before the readers and the workers are created. The files are
+ *  checked before starting.
+ *
+ *  \param readers number of readers.
+ *  \return 1 for Success and 0 for Failure.
+ */
+
+int init_stream(unsigned int readers) {
+  for (int i = 0; i < num_files; i++)
+    if (strcmp(filenames[i], "-") != 0 && access(filenames[i], R_OK) != 0) {
+      fprintf(stderr, "Error! File %s not found.\n", filenames[i]);
+      return 0;
+    }
+
+  num_readers = readers;
+  num_slots = STREAM_BUFFERS_PER_WORKER * (long)num_workers;
+  if (num_slots < 2 * (long)num_readers)                                          /* a buffer in flight per reader */
+    num_slots = 2 * (long)num_readers;
+
+  if (posix_memalign((void **)&ring, CACHE_LINE, num_slots * sizeof(StreamSlot)) != 0) {
+    perror("error on allocating the ring");
+    return 0;
+  }
+
+  for (long s = 0; s < num_slots; s++) {
+    if (posix_memalign((void **)&ring[s].data, CACHE_LINE, STREAM_BUFFER_SIZE) != 0) {
+      perror("error on allocating a buffer");
+      return 0;
+    }
+    ring[s].len = 0;
+    ring[s].state = SLOT_FREE;
+  }
+
+  if ((files = malloc(num_files * sizeof(StreamFile))) == NULL ||
+      (status_reader = malloc(num_readers * sizeof(int))) == NULL) {
+    perror("error on allocating the state of the files");
+    return 0;
+  }
+
+  for (int i = 0; i < num_files; i++) {
+    init_count_state(&files[i].state);
+    init_text_stats(&files[i].stats);
+    init_count_state(&files[i].word_state);
+    files[i].token.len = files[i].token.cut = 0;
+    files[i].bytes = 0;
+  }
+
+  pthread_cond_init(&slot_free, NULL);
+  pthread_cond_init(&slot_filled, NULL);
+
+  return 1;
+}
+
+/**
+ *  \brief Enter the monitor, terminating the calling thread on error.
+ *
+ *  \param status where the error is reported.
+ *  \param where name of the operation.
+ */
+
+static void enter_monitor(int *status, const char *where) {
+  if ((*status = pthread_mutex_lock(&ring_access)) != 0) {                                       /* enter monitor */
+    errno = *status;                                                                       /* save error in errno */
+    perror(where);
+    *status = EXIT_FAILURE;
+    pthread_exit(status);
+  }
+}
+
+/**
+ *  \brief Exit the monitor, terminating the calling thread on error.
+ *
+ *  \param status where the error is reported.
+ *  \param where name of the operation.
+ */
+
+static void exit_monitor(int *status, const char *where) {
+  if ((*status = pthread_mutex_unlock(&ring_access)) != 0) {                                      /* exit monitor */
+    errno = *status;                                                                       /* save error in errno */
+    perror(where);
+    *status = EXIT_FAILURE;
+    pthread_exit(status);
+  }
+}
+
+/**
+ *  \brief Claim the next buffer of the ring.
+ *
+ *  Operation carried out by the readers. It waits for the buffer to be handed back.
+ *
+ *  \param id reader identification.
+ *  \param file_index file the buffer is filled from.
+ *  \return buffer.
+ */
+
+static StreamSlot *claim_stream_buffer(unsigned int id, int file_index) {
+  StreamSlot *slot;
+
+  enter_monitor(&status_reader[id], "error on entering monitor(RB)");
+
+  while (ring[claimed % num_slots].state != SLOT_FREE)                          /* wait for the buffer to be merged */
+    if ((status_reader[id] = pthread_cond_wait(&slot_free, &ring_access)) != 0) {
+      errno = status_reader[id];                                                           /* save error in errno */
+      perror("error on waiting in slot_free");
+      status_reader[id] = EXIT_FAILURE;
+      pthread_exit(&status_reader[id]);
+    }
+
+  slot = &ring[claimed++ % num_slots];
+  slot->state = SLOT_READING;
+  slot->file_index = file_index;
+
+  exit_monitor(&status_reader[id], "error on exiting monitor(RB)");
+
+  return slot;
+}
+
+/**
+ *  \brief Hand a filled buffer to the workers.
+ *
+ *  Operation carried out by the readers.
+ *
+ *  \param id reader identification.
+ *  \param slot buffer.
+ */
+
+static void publish_stream_buffer(unsigned int id, StreamSlot *slot) {
+  enter_monitor(&status_reader[id], "error on entering monitor(RB)");
+
+  slot->state = SLOT_FILLED;
+
+  if ((status_reader[id] = pthread_cond_broadcast(&slot_filled)) != 0) {                   /* let the workers know */
+    errno = status_reader[id];                                                             /* save error in errno */
+    perror("error on signaling in slot_filled");
+    status_reader[id] = EXIT_FAILURE;
+    pthread_exit(&status_reader[id]);
+  }
+
+  exit_monitor(&status_reader[id], "error on exiting monitor(RB)");
+}
+
+/**
+ *  \brief Read the next file not taken by another reader into the ring.
+ *
+ *  Operation carried out by the readers. Each buffer is started with the bytes carried over and filled until it
+ *  is full or the file is over; a file that cannot be read, or whose compressed data is damaged, ends where
+ *  the error was found and is flagged as incomplete. The last reader to find no file left marks the end of the
+ *  stream.
+ *
+ *  \param id reader identification.
+ *  \return 1 when a file was read, -1 when it could not be read to its end, 0 when no file was left.
+ */
+
+int read_stream_file(unsigned int id) {
+  unsigned char carry[4];                              /* bytes of a UTF-8 sequence cut by the end of a buffer */
+  size_t carry_len = 0, len;
+  InputSource src;
+  StreamSlot *slot;
+  int file_index, opened;
+  ssize_t n;
+
+  enter_monitor(&status_reader[id], "error on entering monitor(RF)");
+
+  file_index = (next_file < num_files) ? next_file++ : -1;
+  if (file_index < 0 && ++readers_done == num_readers) {
+    end_of_stream = 1;
+    if ((status_reader[id] = pthread_cond_broadcast(&slot_filled)) != 0) {               /* let the workers know */
+      errno = status_reader[id];                                                           /* save error in errno */
+      perror("error on signaling in slot_filled");
+      status_reader[id] = EXIT_FAILURE;
+      pthread_exit(&status_reader[id]);
+    }
+  }
+
+  exit_monitor(&status_reader[id], "error on exiting monitor(RF)");
+
+  if (file_index < 0)
+    return 0;
+
+  opened = open_source(filenames[file_index], &src);
+  n = opened;
+
+  do {
+    /* the buffer belongs to the reader until it is published */
+    slot = claim_stream_buffer(id, file_index);
+    memcpy(slot->data, carry, carry_len);
+    len = carry_len;
+    while (len < STREAM_BUFFER_SIZE && n > 0 &&
+           (n = read_source(&src, slot->data + len, STREAM_BUFFER_SIZE - len)) > 0)
+      len += n;
+
+    /* at the end of the file a cut sequence is counted as malformed */
+    slot->len = (n > 0) ? utf8_complete_length(slot->data, len) : len;
+    slot->last = (n <= 0);
+    if (n < 0 || !opened)                                    /* before the workers can merge the last buffer */
+      array_incomplete[file_index] = 1;
+    carry_len = len - slot->len;
+    memcpy(carry, slot->data + slot->len, carry_len);
+
+    publish_stream_buffer(id, slot);
+  } while (n > 0);
+
+  if (opened)
+    close_source(&src);
+
+  return array_incomplete[file_index] ? -1 : 1;
+}
+
+/**
+ *  \brief Take the next filled buffer.
+ *
+ *  Operation carried out by the workers. It waits until the next buffer is filled or every file was read.
+ *
+ *  \param id worker identification.
+ *  \return number of the buffer in the ring order, or -1 when every file was read.
+ */
+
+long get_stream_buffer(unsigned int id) {
+  long seq = -1;
+
+  enter_monitor(&statusCons[id], "error on entering monitor(GB)");
+
+  while ((taken == claimed || ring[taken % num_slots].state != SLOT_FILLED) &&
+         !(end_of_stream && taken == claimed))                                            /* wait for the readers */
+    if ((statusCons[id] = pthread_cond_wait(&slot_filled, &ring_access)) != 0) {
+      errno = statusCons[id];                                                              /* save error in errno */
+      perror("error on waiting in slot_filled");
+      statusCons[id] = EXIT_FAILURE;
+      pthread_exit(&statusCons[id]);
+    }
+
+  if (taken < claimed && ring[taken % num_slots].state == SLOT_FILLED) {
+    seq = taken++;
+    ring[seq % num_slots].state = SLOT_COUNTING;
+  }
+
+  exit_monitor(&statusCons[id], "error on exiting monitor(GB)");
+
+  return seq;
+}
+
+/**
+ *  \brief Store the results of a file in the results arrays.
+ *
+ *  Operation carried out by the worker that merges the last buffer of the file, inside the monitor.
+ *
+ *  \param file_index index of the file.
+ */
+
+static void save_stream_file(int file_index) {
+  StreamFile *f = &files[file_index];
+
+  array_num_words[file_index] = f->state.total_num_words;
+  array_num_vowels[file_index] = f->state.num_vowels;
+  array_num_cons[file_index] = f->state.num_cons;
+  array_num_bytes[file_index] = f->bytes;
+  array_run_words[file_index] = f->state.total_num_words;
+  if (array_text_stats != NULL) {
+    finish_text_stats(&f->state, &f->stats);
+    array_text_stats[file_index] = f->stats;
+  }
+  if (top_words > 0)
+    finish_word(file_index, &f->word_state, &f->token);
+}
+
+/**
+ *  \brief Count a buffer and merge every buffer counted in order.
+ *
+ *  Operation carried out by the workers. The buffer is counted outside the monitor; inside it the counted
+ *  buffers that follow the merged ones are merged in ring order, each into the state of its file, and handed
+ *  back to the readers.
+ *
+ *  \param id worker identification.
+ *  \param seq number of the buffer in the ring order.
+ */
+
+void count_stream_buffer(unsigned int id, long seq) {
+  StreamSlot *slot = &ring[seq % num_slots];
+  int handed_back = 0;
+
+  if (slot->len > 0) {
+    if (array_text_stats != NULL)
+      count_chunk_stats(slot->data, slot->len, &slot->res, &slot->stats);
+    else
+      count_chunk(slot->data, slot->len, &slot->res);
+    if (top_words > 0)
+      scan_chunk_words(id, slot->file_index, slot->data, slot->len, &slot->words);
+  }
+
+  enter_monitor(&statusCons[id], "error on entering monitor(CB)");
+
+  slot->state = SLOT_COUNTED;
+
+  while (merged < claimed && ring[merged % num_slots].state == SLOT_COUNTED) {
+    StreamSlot *next = &ring[merged % num_slots];
+    StreamFile *f = &files[next->file_index];
+
+    if (next->len > 0) {
+      if (array_text_stats != NULL)
+        merge_chunk_stats(&f->state, &f->stats, &next->res, &next->stats);
+      else
+        merge_chunk(&f->state, &next->res);
+      if (top_words > 0)
+        merge_chunk_words(id, next->file_index, &f->word_state, &f->token, &next->words);
+      f->bytes += next->len;
+    }
+    if (next->last)
+      save_stream_file(next->file_index);
+    next->state = SLOT_FREE;
+    merged++;
+    handed_back = 1;
+  }
+
+  if (handed_back && (statusCons[id] = pthread_cond_broadcast(&slot_free)) != 0) {      /* let the readers know */
+    errno = statusCons[id];                                                                /* save error in errno */
+    perror("error on signaling in slot_free");
+    statusCons[id] = EXIT_FAILURE;
+    pthread_exit(&statusCons[id]);
+  }
+
+  exit_monitor(&statusCons[id], "error on exiting monitor(CB)");
+}
+
+/**
+ *  \brief Release the ring of buffers.
+ *
+ *  Operation carried out by the main thread, after the readers and the workers have terminated.
+ */
+
+void free_stream(void) {
+  for (long s = 0; s < num_slots; s++)
+    free(ring[s].data);
+
+  pthread_cond_destroy(&slot_free);
+  pthread_cond_destroy(&slot_filled);
+  free(ring);
+  free(files);
+  free(status_reader);
+}
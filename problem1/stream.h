@@ -0,0 +1,43 @@
+/**
+ *  \file stream.h (interface file)
+ *
+ *  \brief Problem name: Total number of words, number of words beginning with a vowel and ending with a consonant.
+ *
+ *  Streaming mode.
+ *  The standard input and compressed files are read, and decompressed, by reader threads into a bounded ring of
+ *  large buffers, which the workers count in parallel; the buffer results are merged in file order and the
+ *  buffers are handed back to the readers.
+ *
+ *  Definition of the operations carried out by the readers:
+ *     \li read_stream_file.
+ *
+ *  Definition of the operations carried out by the workers:
+ *     \li get_stream_buffer
+ *     \li count_stream_buffer.
+ *
+ *  Definition of the operations carried out by the main thread:
+ *     \li init_stream
+ *     \li free_stream.
+ *
+ *  \author Eduardo Santos and Pedro Bastos - April 2022
+ */
+
+#ifndef STREAM_H_
+#define STREAM_H_
+
+/** \brief Allocate the ring of buffers and the state of the files. */
+extern int init_stream(unsigned int readers);
+
+/** \brief Read the next file not taken by another reader into the ring. */
+extern int read_stream_file(unsigned int id);
+
+/** \brief Take the next filled buffer. */
+extern long get_stream_buffer(unsigned int id);
+
+/** \brief Count a buffer and merge every buffer counted in order. */
+extern void count_stream_buffer(unsigned int id, long seq);
+
+/** \brief Release the ring of buffers. */
+extern void free_stream(void);
+
+#endif /* STREAM_H_ */
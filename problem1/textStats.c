@@ -0,0 +1,313 @@
+/**
+ *  \file textStats.c (implementation file)
+ *
+ *  \brief Problem name: Total number of words, number of words beginning with a vowel and ending with a consonant.
+ *
+ *  Extended text statistics.
+ *  Word length histogram, letter frequencies and line count. They follow the same state machine as the three
+ *  counts, each character being handed to count_char after its statistics are taken, so a word is exactly a
+ *  word of the counts; its length is the number of characters it holds, inner apostrophes included. Letters are
+ *  counted wherever they appear, the accented ones under their base letter.
+ *
+ *  The bytes are decoded once and go through the scalar path only: the SIMD kernels do not track word
+ *  lengths. A chunk counted without knowing what came before it keeps apart the length of the word open at its
+ *  first character, which merge_chunk_stats adds to the length carried in from the previous chunk.
+ *
+ *  Definition of the operations carried out by the workers:
+ *     \li init_text_stats
+ *     \li count_char_stats
+ *     \li count_buffer_stats
+ *     \li finish_text_stats
+ *     \li count_chunk_stats
+ *     \li merge_chunk_stats
+ *     \li add_text_stats.
+ *
+ *  Definition of the operations carried out by the main thread:
+ *     \li print_text_stats.
+ *
+ *  \author Eduardo Santos and Pedro Bastos - April 2022
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "wordCount.h"
+#include "textStats.h"
+#include "utf8.h"
+#include "probConst.h"
+
+/** \brief variable to save the number of files */
+extern int num_files;
+
+/** \brief array to save the extended statistics of each file, NULL when they are off */
+extern TextStats *array_text_stats;
+
+/** \brief base letter of the accented Latin-1 letters from 0xC0 on, 0 for the others */
+static const char latin1_base[64] = {
+  'a', 'a', 'a', 'a', 0, 0, 0, 'c', 'e', 'e', 'e', 0, 'i', 'i', 'i', 0,                           /* 0xC0..0xCF */
+  0, 0, 'o', 'o', 'o', 'o', 0, 0, 0, 'u', 'u', 'u', 0, 0, 0, 0,                                   /* 0xD0..0xDF */
+  'a', 'a', 'a', 'a', 0, 0, 0, 'c', 'e', 'e', 'e', 0, 'i', 'i', 'i', 0,                           /* 0xE0..0xEF */
+  0, 0, 'o', 'o', 'o', 'o', 0, 0, 0, 'u', 'u', 'u', 0, 0, 0, 0                                    /* 0xF0..0xFF */
+};
+
+/**
+ *  \brief Letter of a char.
+ *
+ *  \param ch_value value of the character.
+ *  \return index of its base letter from 0 ('a') to 25 ('z'), or -1 if it is not a letter.
+ */
+
+static int letter_index(int ch_value) {
+  if (ch_value >= 'a' && ch_value <= 'z')
+    return ch_value - 'a';
+  if (ch_value >= 'A' && ch_value <= 'Z')
+    return ch_value - 'A';
+  if (ch_value >= 0xC0 && ch_value <= 0xFF && latin1_base[ch_value - 0xC0])
+    return latin1_base[ch_value - 0xC0] - 'a';
+
+  return -1;
+}
+
+/**
+ *  \brief Account for a closed word.
+ *
+ *  \param stats extended statistics.
+ *  \param len length of the word.
+ */
+
+static void record_word(TextStats *stats, int len) {
+  stats->word_len[(len < WORD_LEN_BUCKETS) ? len : WORD_LEN_BUCKETS] += 1;
+}
+
+/**
+ *  \brief Reset the extended statistics.
+ *
+ *  \param stats extended statistics.
+ */
+
+void init_text_stats(TextStats *stats) {
+  memset(stats, 0, sizeof(*stats));
+}
+
+/**
+ *  \brief Account for one character, in the counting state and in the extended statistics.
+ *
+ *  Operation carried out by the workers.
+ *
+ *  \param state counting state of the file.
+ *  \param stats extended statistics of the file.
+ *  \param ch_value value of the character.
+ */
+
+void count_char_stats(CountState *state, TextStats *stats, int ch_value) {
+  unsigned char ch_class = char_class(ch_value);
+  int letter = letter_index(ch_value);
+
+  if (ch_value == '\n')
+    stats->lines += 1;
+  if (letter >= 0)
+    stats->letters[letter] += 1;
+
+  /* a lonely apostrophe is skipped by count_char, it neither opens nor closes a word */
+  if (!((ch_class & CHAR_APOSTROPHE) && (char_class(state->value_before) & CHAR_SPLIT))) {
+    if (ch_class & CHAR_SPLIT) {
+      if (!state->end_of_word)
+        record_word(stats, stats->open_len);
+      stats->open_len = 0;
+    }
+    else
+      stats->open_len = state->end_of_word ? 1 : stats->open_len + 1;
+  }
+
+  count_char(state, ch_value);
+}
+
+/**
+ *  \brief Count a byte range, carrying the state of the file and the extended statistics.
+ *
+ *  Operation carried out by the workers.
+ *
+ *  \param state counting state of the file.
+ *  \param stats extended statistics of the file.
+ *  \param buf first byte, which must start an UTF-8 sequence.
+ *  \param len number of bytes.
+ */
+
+void count_buffer_stats(CountState *state, TextStats *stats, const unsigned char *buf, size_t len) {
+  const unsigned char *pos = buf;
+  const unsigned char *end = buf + len;
+  int chars[DECODE_BATCH];
+  int n;
+
+  while ((n = decode_chars(&pos, end, chars, DECODE_BATCH)) > 0)
+    for (int i = 0; i < n; i++)
+      count_char_stats(state, stats, chars[i]);
+}
+
+/**
+ *  \brief Close the word left open at the end of a file.
+ *
+ *  Operation carried out by the worker that saves the results of the file.
+ *
+ *  \param state counting state at the end of the file.
+ *  \param stats extended statistics of the file.
+ */
+
+void finish_text_stats(const CountState *state, TextStats *stats) {
+  if (!state->end_of_word && stats->open_len > 0)
+    record_word(stats, stats->open_len);
+  stats->open_len = 0;
+}
+
+/**
+ *  \brief Count a byte range whose preceding state is unknown, with the extended statistics.
+ *
+ *  Operation carried out by the workers. Splits the chunk as count_chunk does; the word open at the first
+ *  character is closed in the chunk statistics with the length seen in the chunk only, and that length is
+ *  kept in head_len to be corrected on merging.
+ *
+ *  \param buf first byte of the chunk, which must start an UTF-8 sequence.
+ *  \param len number of bytes of the chunk.
+ *  \param res where the partial result is stored.
+ *  \param cs where the partial extended statistics are stored.
+ */
+
+void count_chunk_stats(const unsigned char *buf, size_t len, ChunkResult *res, ChunkStats *cs) {
+  const unsigned char *pos = buf;
+  const unsigned char *end = buf + len;
+  CountState local;                                                 /* worker local counters, no sharing */
+  int chars[DECODE_BATCH];
+  int ch_value, n, before, head_open;
+
+  memset(res, 0, sizeof(*res));
+  memset(cs, 0, sizeof(*cs));
+  init_count_state(&local);
+
+  /* the leading apostrophes and the first character are resolved when merging */
+  while ((ch_value = get_int_buf(&pos, end)) != -1) {
+    if (!(char_class(ch_value) & CHAR_APOSTROPHE)) {
+      res->flag = 1;
+      res->first_char = ch_value;
+      local.value_before = ch_value;
+      local.end_of_word = (char_class(ch_value) & CHAR_SPLIT) != 0;
+      break;
+    }
+    res->lead_apostrophes += 1;
+  }
+
+  head_open = res->flag && !local.end_of_word;
+
+  while ((n = decode_chars(&pos, end, chars, DECODE_BATCH)) > 0)
+    for (int i = 0; i < n; i++) {
+      before = cs->stats.open_len;
+      count_char_stats(&local, &cs->stats, chars[i]);
+      if (head_open && local.end_of_word) {                                      /* the first word is closed */
+        cs->head_len = before;
+        cs->head_closed = 1;
+        head_open = 0;
+      }
+    }
+
+  if (head_open)
+    cs->head_len = cs->stats.open_len;
+
+  res->total_num_words = local.total_num_words;
+  res->num_vowels = local.num_vowels;
+  res->num_cons = local.num_cons;
+  res->value_before = local.value_before;
+  res->end_of_word = local.end_of_word;
+}
+
+/**
+ *  \brief Append the result of the next chunk to the state and the extended statistics of its file.
+ *
+ *  Operation carried out by the worker that merges the file, for its chunks in order.
+ *
+ *  \param state counting state of the file, up to the previous chunk.
+ *  \param stats extended statistics of the file, up to the previous chunk.
+ *  \param res result of the next chunk.
+ *  \param cs extended statistics of the next chunk.
+ */
+
+void merge_chunk_stats(CountState *state, TextStats *stats, const ChunkResult *res, const ChunkStats *cs) {
+
+  /* replay the characters that depend on the previous chunk */
+  for (int i = 0; i < res->lead_apostrophes; i++)
+    count_char_stats(state, stats, 39);
+
+  if (!res->flag)                                                             /* chunk made only of apostrophes */
+    return;
+
+  count_char_stats(state, stats, res->first_char);
+
+  /* the word open at the first character goes on from the length carried in */
+  if (char_class(res->first_char) & CHAR_SPLIT)
+    stats->open_len = cs->stats.open_len;
+  else if (cs->head_closed) {
+    stats->word_len[(cs->head_len < WORD_LEN_BUCKETS) ? cs->head_len : WORD_LEN_BUCKETS] -= 1;
+    record_word(stats, stats->open_len + cs->head_len);
+    stats->open_len = cs->stats.open_len;
+  }
+  else
+    stats->open_len += cs->head_len;
+
+  stats->lines += cs->stats.lines;
+  for (int l = 0; l < NUM_LETTERS; l++)
+    stats->letters[l] += cs->stats.letters[l];
+  for (int b = 0; b <= WORD_LEN_BUCKETS; b++)
+    stats->word_len[b] += cs->stats.word_len[b];
+
+  state->total_num_words += res->total_num_words;
+  state->num_vowels += res->num_vowels;
+  state->num_cons += res->num_cons;
+  state->value_before = res->value_before;
+  state->end_of_word = res->end_of_word;
+}
+
+/**
+ *  \brief Add the extended statistics of a file to a total.
+ *
+ *  \param total running total.
+ *  \param stats statistics of a file.
+ */
+
+void add_text_stats(TextStats *total, const TextStats *stats) {
+  total->lines += stats->lines;
+  for (int l = 0; l < NUM_LETTERS; l++)
+    total->letters[l] += stats->letters[l];
+  for (int b = 0; b <= WORD_LEN_BUCKETS; b++)
+    total->word_len[b] += stats->word_len[b];
+}
+
+/**
+ *  \brief Print the extended statistics of every file together.
+ *
+ *  Operation carried out by the main thread, after the workers have terminated.
+ */
+
+void print_text_stats(void) {
+  TextStats total;
+  long letters = 0;
+
+  if (array_text_stats == NULL)
+    return;
+
+  init_text_stats(&total);
+  for (int i = 0; i < num_files; i++)
+    add_text_stats(&total, &array_text_stats[i]);
+  for (int l = 0; l < NUM_LETTERS; l++)
+    letters += total.letters[l];
+
+  printf("Extended statistics:\n");
+  printf("Number of lines = %ld\n", total.lines);
+
+  printf("Word lengths:\n");
+  for (int b = 1; b <= WORD_LEN_BUCKETS; b++)
+    if (total.word_len[b] > 0)
+      printf("  %2d%s = %ld\n", b, (b == WORD_LEN_BUCKETS) ? "+" : " ", total.word_len[b]);
+
+  printf("Letter frequencies:\n");
+  for (int l = 0; l < NUM_LETTERS; l++)
+    printf("  %c = %ld (%.2f %%)\n", 'a' + l, total.letters[l], letters ? 100.0 * total.letters[l] / letters : 0.0);
+  printf("\n");
+}
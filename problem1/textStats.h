@@ -0,0 +1,77 @@
+/**
+ *  \file textStats.h (interface file)
+ *
+ *  \brief Problem name: Total number of words, number of words beginning with a vowel and ending with a consonant.
+ *
+ *  Extended text statistics.
+ *  Word length histogram, letter frequencies and line count, gathered in the same pass as the three counts
+ *  when they are turned on.
+ *
+ *  Definition of the operations carried out by the workers:
+ *     \li init_text_stats
+ *     \li count_char_stats
+ *     \li count_buffer_stats
+ *     \li finish_text_stats
+ *     \li count_chunk_stats
+ *     \li merge_chunk_stats
+ *     \li add_text_stats.
+ *
+ *  Definition of the operations carried out by the main thread:
+ *     \li print_text_stats.
+ *
+ *  \author Eduardo Santos and Pedro Bastos - April 2022
+ */
+
+#ifndef TEXTSTATS_H_
+#define TEXTSTATS_H_
+
+#include <stddef.h>
+
+#include "wordCount.h"
+
+/** \brief word lengths with a bucket of their own, longer words share the last one */
+#define WORD_LEN_BUCKETS   32
+
+/** \brief number of letters, accented ones are folded into their base letter */
+#define NUM_LETTERS        26
+
+/** \brief extended statistics of a file, or of a chunk */
+typedef struct {
+  long lines;                                                                       /* newline characters */
+  long letters[NUM_LETTERS];                                                     /* occurrences of each letter */
+  long word_len[WORD_LEN_BUCKETS + 1];                          /* words of each length, index 0 unused */
+  int open_len;                                                        /* length of the word not closed yet */
+} TextStats;
+
+/** \brief extended statistics of a chunk and the word open at its first character */
+typedef struct {
+  TextStats stats;                                                    /* everything after the first character */
+  int head_len;                                  /* characters after the first one of the word it opens or continues */
+  int head_closed;                                              /* 1 if that word was closed inside the chunk */
+} ChunkStats;
+
+/** \brief Reset the extended statistics. */
+extern void init_text_stats(TextStats *stats);
+
+/** \brief Account for one character, in the counting state and in the extended statistics. */
+extern void count_char_stats(CountState *state, TextStats *stats, int ch_value);
+
+/** \brief Count a byte range, carrying the state of the file and the extended statistics. */
+extern void count_buffer_stats(CountState *state, TextStats *stats, const unsigned char *buf, size_t len);
+
+/** \brief Close the word left open at the end of a file. */
+extern void finish_text_stats(const CountState *state, TextStats *stats);
+
+/** \brief Count a byte range whose preceding state is unknown, with the extended statistics. */
+extern void count_chunk_stats(const unsigned char *buf, size_t len, ChunkResult *res, ChunkStats *cs);
+
+/** \brief Append the result of the next chunk to the state and the extended statistics of its file. */
+extern void merge_chunk_stats(CountState *state, TextStats *stats, const ChunkResult *res, const ChunkStats *cs);
+
+/** \brief Add the extended statistics of a file to a total. */
+extern void add_text_stats(TextStats *total, const TextStats *stats);
+
+/** \brief Print the extended statistics of every file together. */
+extern void print_text_stats(void);
+
+#endif /* TEXTSTATS_H_ */
@@ -0,0 +1,171 @@
+/**
+ *  \file utf8.c (implementation file)
+ *
+ *  \brief Problem name: Total number of words, number of words beginning with a vowel and ending with a consonant.
+ *
+ *  Table-driven UTF-8 decoder.
+ *  Each byte is mapped to one of 12 classes and the pair (state, class) gives the next state, after the
+ *  automaton of Bjoern Hoehrmann; the bits of the byte that belong to the code point are selected from its
+ *  class, so the bytes need no range tests. ASCII bytes take a fast path, and the loop over the bytes of a
+ *  sequence stops as soon as the state accepts or rejects. Sequences of 1 to 4 bytes are accepted, overlong
+ *  forms, surrogates and values above U+10FFFF are rejected. Malformed input is decoded as U+FFFD and the
+ *  decoder resynchronizes on the next byte that can start a sequence.
+ *
+ *  Definition of the operations carried out by the workers:
+ *     \li get_int_buf
+ *     \li decode_chars
+ *     \li utf8_complete_length.
+ *
+ *  \author Eduardo Santos and Pedro Bastos - April 2022
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "utf8.h"
+
+/** \brief automaton states, multiples of the number of classes to index utf8_next directly */
+#define UTF8_ACCEPT   0
+#define UTF8_REJECT   12
+
+/** \brief class of each byte */
+static const uint8_t utf8_class[256] = {
+   0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,                           /* 0x00..0x1F */
+   0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,                           /* 0x20..0x3F */
+   0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,                           /* 0x40..0x5F */
+   0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,                           /* 0x60..0x7F */
+   1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1, 9,9,9,9,9,9,9,9,9,9,9,9,9,9,9,9,              /* 0x80..0x9F continuation */
+   7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7, 7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,              /* 0xA0..0xBF continuation */
+   8,8,2,2,2,2,2,2,2,2,2,2,2,2,2,2, 2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,                /* 0xC0..0xDF 2 byte lead */
+  10,3,3,3,3,3,3,3,3,3,3,3,3,4,3,3, 11,6,6,6,5,8,8,8,8,8,8,8,8,8,8,8     /* 0xE0..0xEF 3 byte, 0xF0.. 4 byte */
+};
+
+/** \brief next state, indexed by state + class */
+static const uint8_t utf8_next[108] = {
+   0,12,24,36,60,96,84,12,12,12,48,72,                                                          /* accept */
+  12,12,12,12,12,12,12,12,12,12,12,12,                                                          /* reject */
+  12, 0,12,12,12,12,12, 0,12, 0,12,12,                                              /* 1 continuation left */
+  12,24,12,12,12,12,12,24,12,24,12,12,                                             /* 2 continuations left */
+  12,12,12,12,12,12,12,24,12,12,12,12,                                             /* after 0xE0, A0..BF */
+  12,24,12,12,12,12,12,12,12,24,12,12,                                             /* after 0xED, 80..9F */
+  12,12,12,12,12,12,12,36,12,36,12,12,                                             /* after 0xF0, 90..BF */
+  12,36,12,12,12,12,12,36,12,36,12,12,                                             /* 3 continuations left */
+  12,36,12,12,12,12,12,12,12,12,12,12                                              /* after 0xF4, 80..8F */
+};
+
+/**
+ *  \brief Decode the next char of a buffer and convert it to integer.
+ *
+ *  Operation carried out by the workers.
+ *
+ *  \param pos pointer to the current position, advanced past the decoded char.
+ *  \param end end of the buffer.
+ *  \return value, UTF8_REPLACEMENT for a malformed or truncated sequence, or -1 at the end of the buffer.
+ */
+
+int get_int_buf(const unsigned char **pos, const unsigned char *end) {
+  const unsigned char *p = *pos;
+  uint32_t state = UTF8_ACCEPT;
+  uint32_t ch_value = 0;
+
+  if (p >= end) /* if end of buffer */
+    return -1;
+
+  if (*p < 0x80) { /* if is only 1 byte char, return it */
+    *pos = p + 1;
+    return *p;
+  }
+
+  for (; p < end; p++) {
+    uint32_t byte = *p;
+    uint32_t type = utf8_class[byte];
+    uint32_t before = state;
+
+    /* a lead byte keeps the bits its class leaves free, a continuation byte adds 6 bits */
+    ch_value = (state != UTF8_ACCEPT) ? (byte & 0x3Fu) | (ch_value << 6) : (0xFFu >> type) & byte;
+    state = utf8_next[state + type];
+
+    if (state == UTF8_ACCEPT) {
+      *pos = p + 1;
+      return (int)ch_value;
+    }
+
+    if (state == UTF8_REJECT) {
+      /* a byte that breaks a sequence may start the next one */
+      *pos = (before == UTF8_ACCEPT) ? p + 1 : p;
+      return UTF8_REPLACEMENT;
+    }
+  }
+
+  *pos = end;                                                                  /* sequence cut by the end */
+
+  return UTF8_REPLACEMENT;
+}
+
+/**
+ *  \brief Decode up to max chars of a buffer.
+ *
+ *  Operation carried out by the workers. Runs of ASCII are copied 8 bytes at a time, the rest goes through
+ *  the automaton.
+ *
+ *  \param pos pointer to the current position, advanced past the decoded chars.
+ *  \param end end of the buffer.
+ *  \param chars where the values are stored.
+ *  \param max capacity of chars, at least 8.
+ *  \return number of chars decoded, 0 at the end of the buffer.
+ */
+
+int decode_chars(const unsigned char **pos, const unsigned char *end, int *chars, int max) {
+  const unsigned char *p = *pos;
+  uint64_t word;
+  int n = 0;
+
+  while (n < max && p < end) {
+
+    /* eight ASCII bytes in a row */
+    if (n + 8 <= max && end - p >= 8) {
+      memcpy(&word, p, sizeof(word));
+      if ((word & 0x8080808080808080ull) == 0) {
+        for (int i = 0; i < 8; i++)
+          chars[n + i] = p[i];
+        n += 8;
+        p += 8;
+        continue;
+      }
+    }
+
+    chars[n++] = get_int_buf(&p, end);
+  }
+
+  *pos = p;
+
+  return n;
+}
+
+/**
+ *  \brief Length of the bytes of a buffer that can be counted now.
+ *
+ *  Operation carried out by the reader of a stream and by the workers. The end is moved back to the lead byte
+ *  of a sequence that is still missing bytes, at most 3 of them, so that the bytes that follow can be decoded
+ *  as if the buffer had not been cut.
+ *
+ *  \param buf buffer.
+ *  \param len number of bytes in the buffer.
+ *  \return number of bytes up to the cut sequence, or len if there is none.
+ */
+
+size_t utf8_complete_length(const unsigned char *buf, size_t len) {
+  for (size_t back = 1; back <= 3 && back <= len; back++) {
+    unsigned char byte = buf[len - back];
+    size_t need;
+
+    if ((byte & 0xC0) == 0x80)                                                           /* continuation byte */
+      continue;
+
+    need = (byte >= 0xF0) ? 4 : (byte >= 0xE0) ? 3 : (byte >= 0xC0) ? 2 : 1;
+
+    return (need > back) ? len - back : len;
+  }
+
+  return len;
+}
@@ -0,0 +1,35 @@
+/**
+ *  \file utf8.h (interface file)
+ *
+ *  \brief Problem name: Total number of words, number of words beginning with a vowel and ending with a consonant.
+ *
+ *  Table-driven UTF-8 decoder.
+ *  A deterministic automaton validates and decodes sequences of 1 to 4 bytes; malformed input is decoded
+ *  as U+FFFD and the decoder resynchronizes on the next byte that can start a sequence.
+ *
+ *  Definition of the operations carried out by the workers:
+ *     \li get_int_buf
+ *     \li decode_chars
+ *     \li utf8_complete_length.
+ *
+ *  \author Eduardo Santos and Pedro Bastos - April 2022
+ */
+
+#ifndef UTF8_H_
+#define UTF8_H_
+
+#include <stddef.h>
+
+/** \brief value given to malformed sequences */
+#define UTF8_REPLACEMENT   0xFFFD
+
+/** \brief Decode the next char of a buffer and convert it to integer. */
+extern int get_int_buf(const unsigned char **pos, const unsigned char *end);
+
+/** \brief Decode up to max chars of a buffer. */
+extern int decode_chars(const unsigned char **pos, const unsigned char *end, int *chars, int max);
+
+/** \brief Length of the bytes of a buffer that can be counted now. */
+extern size_t utf8_complete_length(const unsigned char *buf, size_t len);
+
+#endif /* UTF8_H_ */
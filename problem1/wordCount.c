@@ -0,0 +1,306 @@
+/**
+ *  \file wordCount.c (implementation file)
+ *
+ *  \brief Problem name: Total number of words, number of words beginning with a vowel and ending with a consonant.
+ *
+ *  Counting kernel shared by the monitor and by the lock-free chunk mode.
+ *
+ *  A chunk can be counted before the chunks preceding it are known: only its leading apostrophes and its first
+ *  other character depend on the carried-in state, so they are stored in the chunk result and replayed when
+ *  the chunks of a file are merged in order. The merged counts are exactly the ones of a serial pass.
+ *
+ *  Definition of the operations carried out by the workers:
+ *     \li count_char
+ *     \li count_buffer
+ *     \li count_chunk.
+ *
+ *  Definition of the operations carried out by the main thread:
+ *     \li init_count_state
+ *     \li merge_chunk.
+ *
+ *  \author Eduardo Santos and Pedro Bastos - April 2022
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "wordCount.h"
+#include "simdCount.h"
+#include "utf8.h"
+#include "probConst.h"
+
+/**
+ *  \brief Class of each Latin-1 char.
+ *
+ *  Replaces the linear scans over the lists of vowels, consonants and splits by a single lookup.
+ */
+
+const unsigned char latin1_class[256] = {
+  /* splits */
+  ['\t'] = CHAR_SPLIT, ['\n'] = CHAR_SPLIT, [' '] = CHAR_SPLIT, ['!'] = CHAR_SPLIT, ['"'] = CHAR_SPLIT,
+  ['('] = CHAR_SPLIT, [')'] = CHAR_SPLIT, [','] = CHAR_SPLIT, ['-'] = CHAR_SPLIT, ['.'] = CHAR_SPLIT,
+  [':'] = CHAR_SPLIT, [';'] = CHAR_SPLIT, ['?'] = CHAR_SPLIT, ['['] = CHAR_SPLIT, [']'] = CHAR_SPLIT,
+  ['`'] = CHAR_SPLIT, ['{'] = CHAR_SPLIT, ['}'] = CHAR_SPLIT, [0xAB] = CHAR_SPLIT, [0xBB] = CHAR_SPLIT,
+
+  /* apostrophe */
+  ['\''] = CHAR_APOSTROPHE,
+
+  /* vowels */
+  ['A'] = CHAR_VOWEL, ['E'] = CHAR_VOWEL, ['I'] = CHAR_VOWEL, ['O'] = CHAR_VOWEL, ['U'] = CHAR_VOWEL,
+  ['a'] = CHAR_VOWEL, ['e'] = CHAR_VOWEL, ['i'] = CHAR_VOWEL, ['o'] = CHAR_VOWEL, ['u'] = CHAR_VOWEL,
+  [0xC0] = CHAR_VOWEL, [0xC1] = CHAR_VOWEL, [0xC2] = CHAR_VOWEL, [0xC3] = CHAR_VOWEL, [0xC8] = CHAR_VOWEL,
+  [0xC9] = CHAR_VOWEL, [0xCA] = CHAR_VOWEL, [0xCC] = CHAR_VOWEL, [0xCD] = CHAR_VOWEL, [0xCE] = CHAR_VOWEL,
+  [0xD2] = CHAR_VOWEL, [0xD3] = CHAR_VOWEL, [0xD4] = CHAR_VOWEL, [0xD5] = CHAR_VOWEL, [0xD9] = CHAR_VOWEL,
+  [0xDA] = CHAR_VOWEL, [0xDB] = CHAR_VOWEL, [0xE0] = CHAR_VOWEL, [0xE1] = CHAR_VOWEL, [0xE2] = CHAR_VOWEL,
+  [0xE3] = CHAR_VOWEL, [0xE8] = CHAR_VOWEL, [0xE9] = CHAR_VOWEL, [0xEA] = CHAR_VOWEL, [0xEC] = CHAR_VOWEL,
+  [0xED] = CHAR_VOWEL, [0xEE] = CHAR_VOWEL, [0xF2] = CHAR_VOWEL, [0xF3] = CHAR_VOWEL, [0xF4] = CHAR_VOWEL,
+  [0xF5] = CHAR_VOWEL, [0xF9] = CHAR_VOWEL, [0xFA] = CHAR_VOWEL, [0xFB] = CHAR_VOWEL,
+
+  /* consonants */
+  ['B'] = CHAR_CONSONANT, ['C'] = CHAR_CONSONANT, ['D'] = CHAR_CONSONANT, ['F'] = CHAR_CONSONANT,
+  ['G'] = CHAR_CONSONANT, ['H'] = CHAR_CONSONANT, ['J'] = CHAR_CONSONANT, ['K'] = CHAR_CONSONANT,
+  ['L'] = CHAR_CONSONANT, ['M'] = CHAR_CONSONANT, ['N'] = CHAR_CONSONANT, ['P'] = CHAR_CONSONANT,
+  ['Q'] = CHAR_CONSONANT, ['R'] = CHAR_CONSONANT, ['S'] = CHAR_CONSONANT, ['T'] = CHAR_CONSONANT,
+  ['V'] = CHAR_CONSONANT, ['W'] = CHAR_CONSONANT, ['X'] = CHAR_CONSONANT, ['Y'] = CHAR_CONSONANT,
+  ['Z'] = CHAR_CONSONANT, ['b'] = CHAR_CONSONANT, ['c'] = CHAR_CONSONANT, ['d'] = CHAR_CONSONANT,
+  ['f'] = CHAR_CONSONANT, ['g'] = CHAR_CONSONANT, ['h'] = CHAR_CONSONANT, ['j'] = CHAR_CONSONANT,
+  ['k'] = CHAR_CONSONANT, ['l'] = CHAR_CONSONANT, ['m'] = CHAR_CONSONANT, ['n'] = CHAR_CONSONANT,
+  ['p'] = CHAR_CONSONANT, ['q'] = CHAR_CONSONANT, ['r'] = CHAR_CONSONANT, ['s'] = CHAR_CONSONANT,
+  ['t'] = CHAR_CONSONANT, ['v'] = CHAR_CONSONANT, ['w'] = CHAR_CONSONANT, ['x'] = CHAR_CONSONANT,
+  ['y'] = CHAR_CONSONANT, ['z'] = CHAR_CONSONANT, [0xC7] = CHAR_CONSONANT, [0xE7] = CHAR_CONSONANT
+};
+
+/** \brief Class of each General Punctuation char from PUNCT_FIRST on. */
+const unsigned char punct_class[PUNCT_COUNT] = {
+  [0x2013 - PUNCT_FIRST] = CHAR_SPLIT,                                                          /* en dash */
+  [0x2014 - PUNCT_FIRST] = CHAR_SPLIT,                                                          /* em dash */
+  [0x2018 - PUNCT_FIRST] = CHAR_APOSTROPHE,                                    /* left single quotation mark */
+  [0x2019 - PUNCT_FIRST] = CHAR_APOSTROPHE,                                   /* right single quotation mark */
+  [0x201C - PUNCT_FIRST] = CHAR_SPLIT,                                         /* left double quotation mark */
+  [0x201D - PUNCT_FIRST] = CHAR_SPLIT,                                        /* right double quotation mark */
+  [0x2026 - PUNCT_FIRST] = CHAR_SPLIT                                              /* horizontal ellipsis */
+};
+
+/**
+ *  \brief Check if a given char is a vowel.
+ *
+ *  Operation carried out by the workers.
+ *
+ *  \param char_value character value to be checked.
+ *  \return 1 if is a vowel, 0 otherwise.
+ */
+
+int is_vowel(int char_value) {
+  return (char_class(char_value) & CHAR_VOWEL) != 0;
+}
+
+/**
+ *  \brief Check if a given char is a consonant.
+ *
+ *  Operation carried out by the workers.
+ *
+ *  \param char_value character value to be checked.
+ *  \return 1 if is a consonant, 0 otherwise.
+ */
+
+int is_consonant(int char_value) {
+  return (char_class(char_value) & CHAR_CONSONANT) != 0;
+}
+
+/**
+ *  \brief Check if a given char is a split.
+ *
+ *  Operation carried out by the workers.
+ *
+ *  \param char_value character value to be checked.
+ *  \return 1 if is a split, 0 otherwise.
+ */
+
+int is_split(int char_value) {
+  return (char_class(char_value) & CHAR_SPLIT) != 0;
+}
+
+/**
+ *  \brief Check if a given char is an apostrophe.
+ *
+ *  Operation carried out by the workers.
+ *
+ *  \param char_value character value to be checked.
+ *  \return 1 if is an apostrophe, 0 otherwise.
+ */
+
+int is_apostrophe(int char_value) {
+  return (char_class(char_value) & CHAR_APOSTROPHE) != 0;
+}
+
+/**
+ *  \brief Reset a counting state to the beginning of a file.
+ *
+ *  A file starts as if a word had just ended, so that its first character opens the first word.
+ *
+ *  \param state counting state.
+ */
+
+void init_count_state(CountState *state) {
+  memset(state, 0, sizeof(*state));
+  state->end_of_word = 1;
+}
+
+/**
+ *  \brief Account for one character.
+ *
+ *  Operation carried out by the workers.
+ *
+ *  \param state counting state of the file.
+ *  \param ch_value value of the character.
+ */
+
+void count_char(CountState *state, int ch_value) {
+  unsigned char ch_class = char_class(ch_value);
+  unsigned char class_before = char_class(state->value_before);
+
+  /* check if is a lonely apostrophe to avoid counting as word */
+  if ((ch_class & CHAR_APOSTROPHE) && (class_before & CHAR_SPLIT))
+    return;
+
+  /* if is split char */
+  if (ch_class & CHAR_SPLIT) {
+
+    /* check if previous char was a consonant */
+    if (class_before & CHAR_CONSONANT)
+      state->num_cons += 1;
+
+    state->end_of_word = 1;
+  }
+
+  /* not a split char, check if is end of word to sum total words */
+  else if (state->end_of_word == 1) {
+
+    state->total_num_words += 1;
+    state->end_of_word = 0;
+
+    /* if first char of new word is vowel */
+    if (ch_class & CHAR_VOWEL)
+      state->num_vowels += 1;
+  }
+
+  /* save previous char to check in next iteration */
+  state->value_before = ch_value;
+}
+
+/**
+ *  \brief Count a byte range, carrying the state of the file.
+ *
+ *  Operation carried out by the workers. Plain ASCII stretches go through the SIMD fast path, and the blocks
+ *  holding multibyte chars are decoded a batch of chars at a time.
+ *
+ *  \param state counting state of the file.
+ *  \param buf first byte, which must start an UTF-8 sequence.
+ *  \param len number of bytes.
+ */
+
+void count_buffer(CountState *state, const unsigned char *buf, size_t len) {
+  const unsigned char *pos = buf;
+  const unsigned char *end = buf + len;
+  const unsigned char *stop;
+  int chars[DECODE_BATCH];
+  int n;
+
+  while (pos < end) {
+    pos = count_ascii(state, pos, end);
+
+    /* scalar path up to the end of the block the fast path stopped at */
+    stop = (end - pos > SIMD_BLOCK) ? pos + SIMD_BLOCK : end;
+    while (pos < stop) {
+      n = decode_chars(&pos, end, chars, DECODE_BATCH);
+      for (int i = 0; i < n; i++)
+        count_char(state, chars[i]);
+    }
+  }
+}
+
+/**
+ *  \brief Count a byte range whose preceding state is unknown.
+ *
+ *  Operation carried out by the workers.
+ *
+ *  \param buf first byte of the chunk, which must start an UTF-8 sequence.
+ *  \param len number of bytes of the chunk.
+ *  \param res where the partial result is stored.
+ */
+
+void count_chunk(const unsigned char *buf, size_t len, ChunkResult *res) {
+  const unsigned char *pos = buf;
+  const unsigned char *end = buf + len;
+  CountState local;                                                 /* worker local counters, no sharing */
+  int ch_value;
+
+  memset(res, 0, sizeof(*res));
+  init_count_state(&local);
+
+  /* the leading apostrophes and the first character are resolved when merging */
+  while ((ch_value = get_int_buf(&pos, end)) != -1) {
+    if (!(char_class(ch_value) & CHAR_APOSTROPHE)) {
+      res->flag = 1;
+      res->first_char = ch_value;
+      local.value_before = ch_value;
+      local.end_of_word = (char_class(ch_value) & CHAR_SPLIT) != 0;
+      break;
+    }
+    res->lead_apostrophes += 1;
+  }
+
+  count_buffer(&local, pos, end - pos);
+
+  res->total_num_words = local.total_num_words;
+  res->num_vowels = local.num_vowels;
+  res->num_cons = local.num_cons;
+  res->value_before = local.value_before;
+  res->end_of_word = local.end_of_word;
+}
+
+/**
+ *  \brief Append the result of the next chunk to the state of its file.
+ *
+ *  Operation carried out by the main thread, for the chunks of a file in order.
+ *
+ *  \param state counting state of the file, up to the previous chunk.
+ *  \param res result of the next chunk.
+ */
+
+void merge_chunk(CountState *state, const ChunkResult *res) {
+
+  /* replay the characters that depend on the previous chunk */
+  for (int i = 0; i < res->lead_apostrophes; i++)
+    count_char(state, 39);
+
+  if (!res->flag)                                                             /* chunk made only of apostrophes */
+    return;
+
+  count_char(state, res->first_char);
+
+  state->total_num_words += res->total_num_words;
+  state->num_vowels += res->num_vowels;
+  state->num_cons += res->num_cons;
+  state->value_before = res->value_before;
+  state->end_of_word = res->end_of_word;
+}
+
+/**
+ *  \brief Advance a chunk boundary so that it does not split an UTF-8 sequence.
+ *
+ *  Both chunks sharing a boundary compute it with this function, so they agree on it.
+ *
+ *  \param buf bytes around the boundary.
+ *  \param len number of bytes available.
+ *  \param pos nominal boundary.
+ *  \return position of the first byte at or after pos that is not a continuation byte.
+ */
+
+size_t align_chunk(const unsigned char *buf, size_t len, size_t pos) {
+  while (pos < len && (buf[pos] & 0xC0) == 0x80)
+    pos++;
+
+  return pos;
+}
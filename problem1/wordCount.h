@@ -0,0 +1,118 @@
+/**
+ *  \file wordCount.h (interface file)
+ *
+ *  \brief Problem name: Total number of words, number of words beginning with a vowel and ending with a consonant.
+ *
+ *  Counting kernel shared by the monitor and by the lock-free chunk mode.
+ *
+ *  Definition of the operations carried out by the workers:
+ *     \li count_char
+ *     \li count_buffer
+ *     \li count_chunk.
+ *
+ *  Definition of the operations carried out by the main thread:
+ *     \li init_count_state
+ *     \li merge_chunk.
+ *
+ *  \author Eduardo Santos and Pedro Bastos - April 2022
+ */
+
+#ifndef WORDCOUNT_H_
+#define WORDCOUNT_H_
+
+#include <stddef.h>
+
+/** \brief size of a cache line, used to keep per-worker data apart */
+#define CACHE_LINE   64
+
+/** \brief char classes, a char may belong to none of them */
+#define CHAR_VOWEL        0x01
+#define CHAR_CONSONANT    0x02
+#define CHAR_SPLIT        0x04
+#define CHAR_APOSTROPHE   0x08
+
+/** \brief range of the General Punctuation block covered by punct_class */
+#define PUNCT_FIRST       0x2010
+#define PUNCT_COUNT       (0x2026 - PUNCT_FIRST + 1)
+
+/** \brief class of each Latin-1 char */
+extern const unsigned char latin1_class[256];
+
+/** \brief class of each General Punctuation char from PUNCT_FIRST on */
+extern const unsigned char punct_class[PUNCT_COUNT];
+
+/**
+ *  \brief Class of a char, with a single table lookup.
+ *
+ *  \param char_value character value.
+ *  \return CHAR_* flags of the char.
+ */
+
+static inline unsigned char char_class(int char_value) {
+  if ((unsigned int)char_value < 256)
+    return latin1_class[char_value];
+
+  if ((unsigned int)(char_value - PUNCT_FIRST) < PUNCT_COUNT)
+    return punct_class[char_value - PUNCT_FIRST];
+
+  return 0;
+}
+
+/** \brief counting state of a file, carried from one character (or chunk) to the next */
+typedef struct {
+  long total_num_words;                                                        /* total number of words */
+  long num_vowels;                                              /* number of words beginning with a vowel */
+  long num_cons;                                                /* number of words ending with a consonant */
+  int value_before;                                                       /* last character not skipped */
+  int end_of_word;                                          /* 1 if the last character closed a word */
+} CountState;
+
+/**
+ *  \brief Result of counting a byte range of a file without knowing what came before it.
+ *
+ *  Only the leading apostrophes and the first other character of a chunk depend on the state carried in from
+ *  the previous chunk, so they are kept aside and replayed by merge_chunk; everything after them is counted
+ *  locally. Padded to a cache line so that workers writing neighbouring results do not share one.
+ */
+typedef struct {
+  long total_num_words;                                      /* words started after the first character */
+  long num_vowels;                                   /* vowel-initial words started after the first character */
+  long num_cons;                                     /* consonant-final words closed after the first character */
+  int value_before;                                                 /* carry-out: last character not skipped */
+  int end_of_word;                                                  /* carry-out: 1 if the chunk ends a word */
+  int flag;                                            /* 1 once the first non-apostrophe character was seen */
+  int first_char;                                                  /* first non-apostrophe character */
+  int lead_apostrophes;                                        /* apostrophes preceding first_char */
+} __attribute__((aligned(CACHE_LINE))) ChunkResult;
+
+/** \brief Check if a given char is a vowel. */
+extern int is_vowel(int char_value);
+
+/** \brief Check if a given char is a consonant. */
+extern int is_consonant(int char_value);
+
+/** \brief Check if a given char is a split. */
+extern int is_split(int char_value);
+
+/** \brief Check if a given char is an apostrophe. */
+extern int is_apostrophe(int char_value);
+
+/** \brief Reset a counting state to the beginning of a file. */
+extern void init_count_state(CountState *state);
+
+/** \brief Account for one character. */
+extern void count_char(CountState *state, int ch_value);
+
+/** \brief Count a byte range, carrying the state of the file. */
+extern void count_buffer(CountState *state, const unsigned char *buf, size_t len);
+
+/** \brief Count a byte range whose preceding state is unknown. */
+extern void count_chunk(const unsigned char *buf, size_t len, ChunkResult *res);
+
+/** \brief Append the result of the next chunk to the state of its file. */
+extern void merge_chunk(CountState *state, const ChunkResult *res);
+
+/** \brief Advance a chunk boundary so that it does not split an UTF-8 sequence. */
+extern size_t align_chunk(const unsigned char *buf, size_t len, size_t pos);
+
+#endif /* WORDCOUNT_H_ */
@@ -0,0 +1,951 @@
+/**
+ *  \file wordFreq.c (implementation file)
+ *
+ *  \brief Problem name: Total number of words, number of words beginning with a vowel and ending with a consonant.
+ *
+ *  Most frequent words.
+ *  A word is what the counting takes as a word: the characters from the one that opens it to the split that
+ *  closes it, the apostrophes skipped by the counting left out. It is kept lower case, with every apostrophe
+ *  as U+0027, and cut after WORD_MAX_BYTES bytes, so longer words are collected under their first bytes.
+ *
+ *  Each worker collects the words it reads, with the index of their file, in a table of its own whose keys
+ *  live in an arena of its own. When the table holds WORD_LOCAL_ENTRIES words, and when the worker is done,
+ *  its words are moved to a global table split in WORD_SHARDS shards by the hash of the word, each shard with
+ *  its own lock, table and arena; the words are grouped by shard first, so a worker takes each lock once per
+ *  move and the workers start from different shards. A word of every file lands in the same shard, so after
+ *  the workers have terminated every shard is sorted and ranked on its own, each word pushed into a heap of
+ *  the top words of its file and, with the counts of all the files added up, into a heap of the top words of
+ *  all the files.
+ *
+ *  Chunks are scanned without knowing what came before them, as in count_chunk: the word open at the first
+ *  character and the one left open at the end are kept with the chunk and joined to their neighbours when the
+ *  chunks are merged in file order.
+ *
+ *  Definition of the operations carried out by the workers:
+ *     \li word_char
+ *     \li count_buffer_words
+ *     \li finish_word
+ *     \li scan_chunk_words
+ *     \li merge_chunk_words
+ *     \li flush_words.
+ *
+ *  Definition of the operations carried out by the main thread:
+ *     \li init_word_freq
+ *     \li rank_words
+ *     \li print_top_words
+ *     \li free_word_freq.
+ *
+ *  \author Eduardo Santos and Pedro Bastos - April 2022
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <errno.h>
+
+#include "probConst.h"
+#include "wordCount.h"
+#include "wordFreq.h"
+#include "utf8.h"
+
+/** \brief number of workers */
+extern unsigned int num_workers;
+
+/** \brief worker threads return status array */
+extern int *statusCons;
+
+/** \brief array of the filenames retrieved from the main file */
+extern char **filenames;
+
+/** \brief variable to save the number of files */
+extern int num_files;
+
+/** \brief number of most frequent words reported, 0 when they are off */
+extern int top_words;
+
+/** \brief initial number of slots of a shard */
+#define SHARD_SLOTS    1024
+
+/** \brief block of an arena of keys */
+typedef struct ArenaBlock {
+  struct ArenaBlock *next;                                                             /* block filled before */
+  size_t used;                                                                           /* bytes handed out */
+  unsigned char data[];                                                                             /* keys */
+} ArenaBlock;
+
+/** \brief a word of a file and the times it was seen */
+typedef struct {
+  const unsigned char *key;                                     /* bytes of the word, NULL for a free slot */
+  uint64_t hash;                                                                        /* hash of the word */
+  long count;                                                                        /* occurrences */
+  int len;                                                                             /* number of bytes */
+  int file_index;                                                                          /* file */
+} WordEntry;
+
+/** \brief open addressing table of words, with linear probing */
+typedef struct {
+  WordEntry *slots;                                                                            /* slots */
+  long cap;                                                                 /* number of slots, a power of 2 */
+  long used;                                                                           /* slots in use */
+  ArenaBlock *arena;                                                             /* keys of the words */
+} WordTable;
+
+/** \brief words collected by a worker, on cache lines of its own */
+typedef struct {
+  WordTable table;                                                                         /* words */
+  int *order;                                                       /* slots grouped by shard, when moving */
+} __attribute__((aligned(CACHE_LINE))) LocalWords;
+
+/** \brief a shard of the global table */
+typedef struct {
+  pthread_mutex_t lock;                                                  /* mutual exclusion on the shard */
+  WordTable table;                                                                         /* words */
+} __attribute__((aligned(CACHE_LINE))) WordShard;
+
+/** \brief a ranked word */
+typedef struct {
+  const unsigned char *key;                                                          /* bytes of the word */
+  int len;                                                                             /* number of bytes */
+  long count;                                                                        /* occurrences */
+} TopWord;
+
+/** \brief most frequent words, a heap with the least frequent at the root until sorted */
+typedef struct {
+  TopWord *words;                                                                           /* words */
+  int size;                                                                            /* number of words */
+} TopList;
+
+/** \brief words of each worker */
+static LocalWords *local_words;
+
+/** \brief shards of the global table */
+static WordShard shards[WORD_SHARDS];
+
+/** \brief top words of each file, by file index when ranked */
+static TopList *file_tops;
+
+/** \brief name of each ranked file */
+static const char **top_names;
+
+/** \brief number of ranked files */
+static int num_ranked = 0;
+
+/** \brief top words of all the files */
+static TopList corpus_top;
+
+/** \brief number of distinct words of all the files */
+static long distinct_words = 0;
+
+/** \brief 1 once the words are ranked, 0 if ranking them failed */
+static int ranked = 0;
+
+/**
+ *  \brief Hand out bytes from an arena.
+ *
+ *  \param arena arena.
+ *  \param len number of bytes, at most WORD_ARENA_BLOCK.
+ *  \return bytes, or NULL if out of memory.
+ */
+
+static unsigned char *arena_alloc(ArenaBlock **arena, size_t len) {
+  ArenaBlock *block = *arena;
+  unsigned char *p;
+
+  if (block == NULL || block->used + len > WORD_ARENA_BLOCK) {
+    if ((block = malloc(sizeof(ArenaBlock) + WORD_ARENA_BLOCK)) == NULL)
+      return NULL;
+    block->next = *arena;
+    block->used = 0;
+    *arena = block;
+  }
+
+  p = block->data + block->used;
+  block->used += len;
+
+  return p;
+}
+
+/**
+ *  \brief Release every block of an arena.
+ *
+ *  \param arena arena.
+ */
+
+static void arena_release(ArenaBlock **arena) {
+  ArenaBlock *next;
+
+  for (ArenaBlock *block = *arena; block != NULL; block = next) {
+    next = block->next;
+    free(block);
+  }
+  *arena = NULL;
+}
+
+/**
+ *  \brief 64 bit FNV-1a hash of a word.
+ */
+
+static uint64_t hash_word(const unsigned char *key, int len) {
+  uint64_t h = 0xCBF29CE484222325ull;
+
+  for (int i = 0; i < len; i++)
+    h = (h ^ key[i]) * 0x100000001B3ull;
+
+  return h;
+}
+
+/**
+ *  \brief Slot of a word of a file, mixing in the file index.
+ */
+
+static uint64_t slot_hash(uint64_t hash, int file_index) {
+  uint64_t x = hash ^ ((uint64_t)file_index * 0x9E3779B97F4A7C15ull);
+
+  x ^= x >> 33;
+  x *= 0xFF51AFD7ED558CCDull;
+  x ^= x >> 33;
+
+  return x;
+}
+
+/**
+ *  \brief Shard of a word, the same for every file.
+ */
+
+static int shard_of(uint64_t hash) {
+  return (int)(((hash * 0x9E3779B97F4A7C15ull) >> 32) % WORD_SHARDS);
+}
+
+/**
+ *  \brief Allocate the slots of a table.
+ *
+ *  \param t table.
+ *  \param cap number of slots, a power of 2.
+ *  \return 1 for Success and 0 for Failure.
+ */
+
+static int table_init(WordTable *t, long cap) {
+  t->cap = cap;
+  t->used = 0;
+  t->arena = NULL;
+
+  return (t->slots = calloc(cap, sizeof(WordEntry))) != NULL;
+}
+
+/**
+ *  \brief Double the slots of a table.
+ *
+ *  \param t table.
+ *  \return 1 for Success and 0 for Failure.
+ */
+
+static int table_grow(WordTable *t) {
+  WordEntry *old = t->slots;
+  long old_cap = t->cap;
+  long mask = 2 * old_cap - 1;
+
+  if ((t->slots = calloc(2 * old_cap, sizeof(WordEntry))) == NULL) {
+    t->slots = old;
+    return 0;
+  }
+  t->cap = 2 * old_cap;
+
+  for (long i = 0; i < old_cap; i++)
+    if (old[i].key != NULL) {
+      long j = slot_hash(old[i].hash, old[i].file_index) & mask;
+
+      while (t->slots[j].key != NULL)
+        j = (j + 1) & mask;
+      t->slots[j] = old[i];
+    }
+
+  free(old);
+
+  return 1;
+}
+
+/**
+ *  \brief Add occurrences of a word of a file to a table, copying the key to the arena of the table if the
+ *  word is new.
+ *
+ *  \param t table.
+ *  \param key bytes of the word.
+ *  \param len number of bytes.
+ *  \param hash hash of the word.
+ *  \param file_index file.
+ *  \param count occurrences.
+ *  \return 1 for Success and 0 for Failure.
+ */
+
+static int table_add(WordTable *t, const unsigned char *key, int len, uint64_t hash, int file_index, long count) {
+  WordEntry *e;
+  unsigned char *copy;
+  long mask, j;
+
+  if ((t->used + 1) * 4 > t->cap * 3 && !table_grow(t))
+    return 0;
+
+  mask = t->cap - 1;
+  for (j = slot_hash(hash, file_index) & mask; t->slots[j].key != NULL; j = (j + 1) & mask) {
+    e = &t->slots[j];
+    if (e->hash == hash && e->file_index == file_index && e->len == len && memcmp(e->key, key, len) == 0) {
+      e->count += count;
+      return 1;
+    }
+  }
+
+  if ((copy = arena_alloc(&t->arena, len)) == NULL)
+    return 0;
+  memcpy(copy, key, len);
+
+  e = &t->slots[j];
+  e->key = copy;
+  e->hash = hash;
+  e->count = count;
+  e->len = len;
+  e->file_index = file_index;
+  t->used++;
+
+  return 1;
+}
+
+/**
+ *  \brief Release a table.
+ */
+
+static void table_free(WordTable *t) {
+  free(t->slots);
+  arena_release(&t->arena);
+}
+
+/**
+ *  \brief Allocate the tables of the workers and the shards of the global table.
+ *
+ *  Operation carried out by the main thread, before the workers are created.
+ *
+ *  \return 1 for Success and 0 for Failure.
+ */
+
+int init_word_freq(void) {
+  if (posix_memalign((void **)&local_words, CACHE_LINE, num_workers * sizeof(LocalWords)) != 0) {
+    perror("error on allocating the word tables");
+    return 0;
+  }
+
+  /* at most half full, the table of a worker never grows */
+  for (unsigned int i = 0; i < num_workers; i++)
+    if (!table_init(&local_words[i].table, 2 * WORD_LOCAL_ENTRIES)
+        || (local_words[i].order = malloc(WORD_LOCAL_ENTRIES * sizeof(int))) == NULL) {
+      perror("error on allocating the word tables");
+      return 0;
+    }
+
+  for (int s = 0; s < WORD_SHARDS; s++) {
+    pthread_mutex_init(&shards[s].lock, NULL);
+    if (!table_init(&shards[s].table, SHARD_SLOTS)) {
+      perror("error on allocating the word tables");
+      return 0;
+    }
+  }
+
+  return 1;
+}
+
+/**
+ *  \brief Append a character to a word, lower case and with apostrophes as U+0027.
+ *
+ *  \param tok word.
+ *  \param ch_value value of the character.
+ */
+
+static void append_char(WordToken *tok, int ch_value) {
+  unsigned char enc[4];
+  int n;
+
+  if (tok->cut)
+    return;
+
+  if (ch_value >= 'A' && ch_value <= 'Z')
+    ch_value += 'a' - 'A';
+  else if (ch_value >= 0xC0 && ch_value <= 0xDE && ch_value != 0xD7)              /* Latin-1 upper case letters */
+    ch_value += 0x20;
+  else if (char_class(ch_value) & CHAR_APOSTROPHE)
+    ch_value = '\'';
+
+  if (ch_value < 0x80) {
+    enc[0] = ch_value;
+    n = 1;
+  }
+  else if (ch_value < 0x800) {
+    enc[0] = 0xC0 | (ch_value >> 6);
+    enc[1] = 0x80 | (ch_value & 0x3F);
+    n = 2;
+  }
+  else if (ch_value < 0x10000) {
+    enc[0] = 0xE0 | (ch_value >> 12);
+    enc[1] = 0x80 | ((ch_value >> 6) & 0x3F);
+    enc[2] = 0x80 | (ch_value & 0x3F);
+    n = 3;
+  }
+  else {
+    enc[0] = 0xF0 | (ch_value >> 18);
+    enc[1] = 0x80 | ((ch_value >> 12) & 0x3F);
+    enc[2] = 0x80 | ((ch_value >> 6) & 0x3F);
+    enc[3] = 0x80 | (ch_value & 0x3F);
+    n = 4;
+  }
+
+  if (tok->len + n > WORD_MAX_BYTES) {
+    tok->cut = 1;
+    return;
+  }
+
+  memcpy(tok->bytes + tok->len, enc, n);
+  tok->len += n;
+}
+
+/**
+ *  \brief Append a word to another, cutting it on a character boundary if it does not fit.
+ *
+ *  \param tok word.
+ *  \param src word appended.
+ */
+
+static void append_token(WordToken *tok, const WordToken *src) {
+  int n = src->len;
+
+  if (tok->cut)
+    return;
+
+  if (n > WORD_MAX_BYTES - tok->len) {
+    n = WORD_MAX_BYTES - tok->len;
+    while (n > 0 && (src->bytes[n] & 0xC0) == 0x80)                                   /* UTF-8 continuation byte */
+      n--;
+    tok->cut = 1;
+  }
+
+  memcpy(tok->bytes + tok->len, src->bytes, n);
+  tok->len += n;
+  tok->cut |= src->cut;
+}
+
+/**
+ *  \brief Account for a character in the word being read, following the counting of count_char.
+ *
+ *  \param tok word being read.
+ *  \param state counting state before the character.
+ *  \param ch_value value of the character.
+ *  \return 1 if the character closes the word, which is left in tok.
+ */
+
+static int feed_char(WordToken *tok, const CountState *state, int ch_value) {
+  unsigned char ch_class = char_class(ch_value);
+
+  if ((ch_class & CHAR_APOSTROPHE) && (char_class(state->value_before) & CHAR_SPLIT))         /* skipped */
+    return 0;
+
+  if (ch_class & CHAR_SPLIT)
+    return !state->end_of_word;
+
+  if (state->end_of_word) {                                                                  /* a new word */
+    tok->len = 0;
+    tok->cut = 0;
+  }
+  append_char(tok, ch_value);
+
+  return 0;
+}
+
+/**
+ *  \brief Collect a word in the table of a worker, moving the table to the global one when it is full.
+ *
+ *  \param id worker identification.
+ *  \param file_index file of the word.
+ *  \param tok word.
+ */
+
+static void add_local(unsigned int id, int file_index, const WordToken *tok) {
+  WordTable *t = &local_words[id].table;
+
+  if (tok->len == 0)                                          /* only the resumed part of a word was lost */
+    return;
+
+  if (t->used >= WORD_LOCAL_ENTRIES)
+    flush_words(id);
+
+  if (!table_add(t, tok->bytes, tok->len, hash_word(tok->bytes, tok->len), file_index, 1)) {
+    perror("error on collecting a word");
+    statusCons[id] = EXIT_FAILURE;
+    pthread_exit(&statusCons[id]);
+  }
+}
+
+/**
+ *  \brief Account for one character in the word being read.
+ *
+ *  Operation carried out by the workers. The counting state is not updated, count_char is called after.
+ *
+ *  \param id worker identification.
+ *  \param file_index file being read.
+ *  \param tok word being read.
+ *  \param state counting state before the character.
+ *  \param ch_value value of the character.
+ */
+
+void word_char(unsigned int id, int file_index, WordToken *tok, const CountState *state, int ch_value) {
+  if (feed_char(tok, state, ch_value))
+    add_local(id, file_index, tok);
+}
+
+/**
+ *  \brief Collect the words of a byte range, carrying the state of the file and the word being read.
+ *
+ *  Operation carried out by the workers.
+ *
+ *  \param id worker identification.
+ *  \param file_index file being read.
+ *  \param state counting state of the file.
+ *  \param tok word being read.
+ *  \param buf first byte, which must start an UTF-8 sequence.
+ *  \param len number of bytes.
+ */
+
+void count_buffer_words(unsigned int id, int file_index, CountState *state, WordToken *tok,
+                        const unsigned char *buf, size_t len) {
+  const unsigned char *pos = buf;
+  const unsigned char *end = buf + len;
+  int chars[DECODE_BATCH];
+  int n;
+
+  while ((n = decode_chars(&pos, end, chars, DECODE_BATCH)) > 0)
+    for (int i = 0; i < n; i++) {
+      word_char(id, file_index, tok, state, chars[i]);
+      count_char(state, chars[i]);
+    }
+}
+
+/**
+ *  \brief Collect the word left open at the end of a file.
+ *
+ *  Operation carried out by the worker that saves the results of the file, or by the main thread for the
+ *  standard input. The word goes straight to its shard, so the calling thread needs no table.
+ *
+ *  \param file_index file.
+ *  \param state counting state at the end of the file.
+ *  \param tok word being read.
+ */
+
+void finish_word(int file_index, const CountState *state, const WordToken *tok) {
+  uint64_t hash;
+  WordShard *shard;
+  int status;
+
+  if (state->end_of_word || tok->len == 0)
+    return;
+
+  hash = hash_word(tok->bytes, tok->len);
+  shard = &shards[shard_of(hash)];
+
+  if ((status = pthread_mutex_lock(&shard->lock)) != 0) {
+    errno = status;                                                                        /* save error in errno */
+    perror("error on entering a word shard");
+    return;
+  }
+
+  if (!table_add(&shard->table, tok->bytes, tok->len, hash, file_index, 1))
+    perror("error on collecting a word");
+
+  if ((status = pthread_mutex_unlock(&shard->lock)) != 0) {
+    errno = status;                                                                        /* save error in errno */
+    perror("error on exiting a word shard");
+  }
+}
+
+/**
+ *  \brief Collect the words of a byte range whose preceding state is unknown.
+ *
+ *  Operation carried out by the workers. The range is split as count_chunk does; the words closed inside it
+ *  are collected by the worker, the ones crossing its ends are kept in wc for merge_chunk_words.
+ *
+ *  \param id worker identification.
+ *  \param file_index file of the chunk.
+ *  \param buf first byte of the chunk, which must start an UTF-8 sequence.
+ *  \param len number of bytes of the chunk.
+ *  \param wc where the words crossing the ends of the chunk are stored.
+ */
+
+void scan_chunk_words(unsigned int id, int file_index, const unsigned char *buf, size_t len, WordChunk *wc) {
+  const unsigned char *pos = buf;
+  const unsigned char *end = buf + len;
+  CountState local;                                                 /* worker local state, no sharing */
+  WordToken cur;                                                                    /* word being read */
+  int chars[DECODE_BATCH];
+  int ch_value, n, in_head;
+
+  memset(wc, 0, sizeof(*wc));
+  init_count_state(&local);
+  cur.len = cur.cut = 0;
+
+  /* the leading apostrophes and the first character are resolved when merging */
+  while ((ch_value = get_int_buf(&pos, end)) != -1) {
+    if (!(char_class(ch_value) & CHAR_APOSTROPHE)) {
+      wc->flag = 1;
+      wc->first_char = ch_value;
+      local.value_before = ch_value;
+      local.end_of_word = (char_class(ch_value) & CHAR_SPLIT) != 0;
+      break;
+    }
+    wc->lead_apostrophes += 1;
+  }
+
+  if ((in_head = wc->flag && !local.end_of_word))
+    append_char(&cur, wc->first_char);
+
+  while ((n = decode_chars(&pos, end, chars, DECODE_BATCH)) > 0)
+    for (int i = 0; i < n; i++) {
+      if (feed_char(&cur, &local, chars[i])) {
+        if (in_head) {                                                  /* its start is in the previous chunk */
+          wc->head = cur;
+          wc->head_closed = 1;
+          in_head = 0;
+        }
+        else
+          add_local(id, file_index, &cur);
+      }
+      count_char(&local, chars[i]);
+    }
+
+  if (in_head)
+    wc->head = cur;
+  else if (!local.end_of_word)
+    wc->tail = cur;
+
+  wc->value_before = local.value_before;
+  wc->end_of_word = local.end_of_word;
+}
+
+/**
+ *  \brief Collect the words that cross the start of the next chunk of a file.
+ *
+ *  Operation carried out by the worker that merges the file, for its chunks in order.
+ *
+ *  \param id worker identification.
+ *  \param file_index file.
+ *  \param state counting state of the file, up to the previous chunk.
+ *  \param tok word left open by the previous chunk.
+ *  \param wc words crossing the ends of the next chunk.
+ */
+
+void merge_chunk_words(unsigned int id, int file_index, CountState *state, WordToken *tok, const WordChunk *wc) {
+
+  /* replay the characters that depend on the previous chunk */
+  for (int i = 0; i < wc->lead_apostrophes; i++) {
+    word_char(id, file_index, tok, state, 39);
+    count_char(state, 39);
+  }
+
+  if (!wc->flag)                                                              /* chunk made only of apostrophes */
+    return;
+
+  if (char_class(wc->first_char) & CHAR_SPLIT) {
+    word_char(id, file_index, tok, state, wc->first_char);
+    *tok = wc->tail;
+  }
+  else {
+    if (state->end_of_word) {                                                  /* the chunk starts a word */
+      tok->len = 0;
+      tok->cut = 0;
+    }
+    append_token(tok, &wc->head);
+    if (wc->head_closed) {
+      add_local(id, file_index, tok);
+      *tok = wc->tail;
+    }
+  }
+
+  state->value_before = wc->value_before;
+  state->end_of_word = wc->end_of_word;
+}
+
+/**
+ *  \brief Move the words collected by a worker to the global table.
+ *
+ *  Operation carried out by the workers, when their table is full and before they terminate. The words are
+ *  grouped by shard, so each shard is locked once, starting from a shard that depends on the worker.
+ *
+ *  \param id worker identification.
+ */
+
+void flush_words(unsigned int id) {
+  WordTable *t = &local_words[id].table;
+  int *order = local_words[id].order;
+  long first[WORD_SHARDS + 1] = { 0 };
+  long next[WORD_SHARDS];
+  int s;
+
+  if (t->used == 0)
+    return;
+
+  for (long i = 0; i < t->cap; i++)
+    if (t->slots[i].key != NULL)
+      first[shard_of(t->slots[i].hash) + 1] += 1;
+  for (s = 0; s < WORD_SHARDS; s++) {
+    first[s + 1] += first[s];
+    next[s] = first[s];
+  }
+  for (long i = 0; i < t->cap; i++)
+    if (t->slots[i].key != NULL)
+      order[next[shard_of(t->slots[i].hash)]++] = i;
+
+  for (int k = 0; k < WORD_SHARDS; k++) {
+    s = (int)((k + (long)id * WORD_SHARDS / num_workers) % WORD_SHARDS);
+    if (first[s] == first[s + 1])
+      continue;
+
+    if ((statusCons[id] = pthread_mutex_lock(&shards[s].lock)) != 0) {                          /* enter shard */
+      errno = statusCons[id];                                                              /* save error in errno */
+      perror("error on entering a word shard");
+      statusCons[id] = EXIT_FAILURE;
+      pthread_exit(&statusCons[id]);
+    }
+
+    for (long j = first[s]; j < first[s + 1]; j++) {
+      WordEntry *e = &t->slots[order[j]];
+
+      if (!table_add(&shards[s].table, e->key, e->len, e->hash, e->file_index, e->count)) {
+        perror("error on collecting a word");
+        pthread_mutex_unlock(&shards[s].lock);
+        statusCons[id] = EXIT_FAILURE;
+        pthread_exit(&statusCons[id]);
+      }
+    }
+
+    if ((statusCons[id] = pthread_mutex_unlock(&shards[s].lock)) != 0) {                         /* exit shard */
+      errno = statusCons[id];                                                              /* save error in errno */
+      perror("error on exiting a word shard");
+      statusCons[id] = EXIT_FAILURE;
+      pthread_exit(&statusCons[id]);
+    }
+  }
+
+  memset(t->slots, 0, t->cap * sizeof(WordEntry));
+  t->used = 0;
+  arena_release(&t->arena);
+}
+
+/**
+ *  \brief Compare the bytes of two words.
+ */
+
+static int compare_keys(const unsigned char *a, int len_a, const unsigned char *b, int len_b) {
+  int c = memcmp(a, b, (len_a < len_b) ? len_a : len_b);
+
+  return c ? c : len_a - len_b;
+}
+
+/**
+ *  \brief Compare two entries by word, then by file.
+ */
+
+static int compare_entries(const void *a, const void *b) {
+  const WordEntry *x = *(const WordEntry *const *)a, *y = *(const WordEntry *const *)b;
+  int c = compare_keys(x->key, x->len, y->key, y->len);
+
+  return c ? c : x->file_index - y->file_index;
+}
+
+/**
+ *  \brief Whether a word ranks before another: more occurrences, then alphabetical order of the bytes.
+ */
+
+static int ranks_before(const TopWord *a, const TopWord *b) {
+  if (a->count != b->count)
+    return a->count > b->count;
+
+  return compare_keys(a->key, a->len, b->key, b->len) < 0;
+}
+
+/**
+ *  \brief Compare two ranked words, for the final order.
+ */
+
+static int compare_top(const void *a, const void *b) {
+  return ranks_before(a, b) ? -1 : ranks_before(b, a) ? 1 : 0;
+}
+
+/**
+ *  \brief Offer a word to a list of top words.
+ *
+ *  \param l list, a heap with the last ranked word at the root.
+ *  \param key bytes of the word.
+ *  \param len number of bytes.
+ *  \param count occurrences.
+ */
+
+static void push_top(TopList *l, const unsigned char *key, int len, long count) {
+  TopWord w = { key, len, count };
+  TopWord *h = l->words;
+  int i, c;
+
+  if (l->size < top_words) {
+    for (i = l->size++; i > 0 && ranks_before(&h[(i - 1) / 2], &w); i = (i - 1) / 2)
+      h[i] = h[(i - 1) / 2];
+    h[i] = w;
+    return;
+  }
+
+  if (!ranks_before(&w, &h[0]))
+    return;
+
+  for (i = 0; (c = 2 * i + 1) < l->size; i = c) {
+    if (c + 1 < l->size && ranks_before(&h[c], &h[c + 1]))
+      c++;
+    if (!ranks_before(&w, &h[c]))
+      break;
+    h[i] = h[c];
+  }
+  h[i] = w;
+}
+
+/**
+ *  \brief Report a failed allocation of the ranking and release what was allocated, so nothing is printed.
+ */
+
+static void drop_ranks(void) {
+  perror("error on allocating the word ranks");
+
+  for (int f = 0; file_tops != NULL && f < num_ranked; f++)
+    free(file_tops[f].words);
+  free(file_tops);
+  free(top_names);
+  free(corpus_top.words);
+
+  file_tops = NULL;
+  top_names = NULL;
+  corpus_top.words = NULL;
+  num_ranked = 0;
+}
+
+/**
+ *  \brief Rank the words of every file and of all the files.
+ *
+ *  Operation carried out by the main thread, after the workers have terminated and before the list of files
+ *  is put back in order by the result cache. Each shard is sorted by word, so the counts of a word in every
+ *  file are next to each other.
+ */
+
+void rank_words(void) {
+  WordEntry **sorted;
+  long n, j, k, sum;
+
+  if (top_words == 0)
+    return;
+
+  num_ranked = num_files;
+  file_tops = calloc(num_ranked, sizeof(TopList));
+  top_names = malloc(num_ranked * sizeof(char *));
+  corpus_top.words = malloc(top_words * sizeof(TopWord));
+  corpus_top.size = 0;
+  if (file_tops == NULL || top_names == NULL || corpus_top.words == NULL) {
+    drop_ranks();
+    return;
+  }
+
+  for (int f = 0; f < num_ranked; f++) {
+    if ((file_tops[f].words = malloc(top_words * sizeof(TopWord))) == NULL) {
+      drop_ranks();
+      return;
+    }
+    top_names[f] = filenames[f];
+  }
+
+  for (int s = 0; s < WORD_SHARDS; s++) {
+    WordTable *t = &shards[s].table;
+
+    if ((sorted = malloc((t->used + 1) * sizeof(WordEntry *))) == NULL) {
+      drop_ranks();
+      return;
+    }
+    for (long i = n = 0; i < t->cap; i++)
+      if (t->slots[i].key != NULL)
+        sorted[n++] = &t->slots[i];
+    qsort(sorted, n, sizeof(WordEntry *), compare_entries);
+
+    for (j = 0; j < n; j = k) {
+      for (k = j, sum = 0; k < n && compare_keys(sorted[j]->key, sorted[j]->len, sorted[k]->key, sorted[k]->len) == 0;
+           k++) {
+        push_top(&file_tops[sorted[k]->file_index], sorted[k]->key, sorted[k]->len, sorted[k]->count);
+        sum += sorted[k]->count;
+      }
+      push_top(&corpus_top, sorted[j]->key, sorted[j]->len, sum);
+      distinct_words++;
+    }
+
+    free(sorted);
+  }
+
+  for (int f = 0; f < num_ranked; f++)
+    qsort(file_tops[f].words, file_tops[f].size, sizeof(TopWord), compare_top);
+  qsort(corpus_top.words, corpus_top.size, sizeof(TopWord), compare_top);
+  ranked = 1;
+}
+
+/**
+ *  \brief Print a list of top words.
+ */
+
+static void print_list(const TopList *l) {
+  for (int i = 0; i < l->size; i++)
+    printf("  %10ld  %.*s\n", l->words[i].count, l->words[i].len, (const char *)l->words[i].key);
+}
+
+/**
+ *  \brief Print the most frequent words.
+ *
+ *  Operation carried out by the main thread, after rank_words.
+ */
+
+void print_top_words(void) {
+  if (top_words == 0 || !ranked)
+    return;
+
+  for (int f = 0; f < num_ranked; f++)
+    if (file_tops[f].size > 0) {
+      printf("Most frequent words of %s:\n", top_names[f]);
+      print_list(&file_tops[f]);
+    }
+
+  printf("Most frequent words of all the files (%ld distinct):\n", distinct_words);
+  print_list(&corpus_top);
+  printf("\n");
+}
+
+/**
+ *  \brief Release the word tables.
+ *
+ *  Operation carried out by the main thread, after the words were printed.
+ */
+
+void free_word_freq(void) {
+  if (top_words == 0)
+    return;
+
+  for (unsigned int i = 0; i < num_workers; i++) {
+    table_free(&local_words[i].table);
+    free(local_words[i].order);
+  }
+  free(local_words);
+
+  for (int s = 0; s < WORD_SHARDS; s++) {
+    table_free(&shards[s].table);
+    pthread_mutex_destroy(&shards[s].lock);
+  }
+
+  for (int f = 0; f < num_ranked; f++)
+    free(file_tops[f].words);
+  free(file_tops);
+  free(top_names);
+  free(corpus_top.words);
+}
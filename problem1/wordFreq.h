@@ -0,0 +1,86 @@
+/**
+ *  \file wordFreq.h (interface file)
+ *
+ *  \brief Problem name: Total number of words, number of words beginning with a vowel and ending with a consonant.
+ *
+ *  Most frequent words.
+ *  The words delimited by the counting are collected in a table local to each worker, moved in batches to a
+ *  global table split in shards, and ranked at the end into the most frequent words of each file and of all
+ *  the files.
+ *
+ *  Definition of the operations carried out by the workers:
+ *     \li word_char
+ *     \li count_buffer_words
+ *     \li finish_word
+ *     \li scan_chunk_words
+ *     \li merge_chunk_words
+ *     \li flush_words.
+ *
+ *  Definition of the operations carried out by the main thread:
+ *     \li init_word_freq
+ *     \li rank_words
+ *     \li print_top_words
+ *     \li free_word_freq.
+ *
+ *  \author Eduardo Santos and Pedro Bastos - April 2022
+ */
+
+#ifndef WORDFREQ_H_
+#define WORDFREQ_H_
+
+#include <stddef.h>
+
+#include "probConst.h"
+#include "wordCount.h"
+
+/** \brief a word being read, lower case, apostrophes as U+0027 */
+typedef struct {
+  unsigned char bytes[WORD_MAX_BYTES];                                                  /* UTF-8 encoded */
+  int len;                                                                              /* number of bytes */
+  int cut;                                                         /* 1 if the word did not fit in bytes */
+} WordToken;
+
+/** \brief words of a chunk that cross its ends, the others are collected while the chunk is scanned */
+typedef struct {
+  WordToken head;                                     /* word opened by the first character, if not a split */
+  WordToken tail;                                                     /* word left open at the end of the chunk */
+  int head_closed;                                              /* 1 if the head word was closed inside the chunk */
+  int flag;                                            /* 1 once the first non-apostrophe character was seen */
+  int first_char;                                                  /* first non-apostrophe character */
+  int lead_apostrophes;                                        /* apostrophes preceding first_char */
+  int value_before;                                                 /* carry-out: last character not skipped */
+  int end_of_word;                                                  /* carry-out: 1 if the chunk ends a word */
+} WordChunk;
+
+/** \brief Allocate the tables of the workers and the shards of the global table. */
+extern int init_word_freq(void);
+
+/** \brief Account for one character in the word being read. */
+extern void word_char(unsigned int id, int file_index, WordToken *tok, const CountState *state, int ch_value);
+
+/** \brief Collect the words of a byte range, carrying the state of the file and the word being read. */
+extern void count_buffer_words(unsigned int id, int file_index, CountState *state, WordToken *tok,
+                               const unsigned char *buf, size_t len);
+
+/** \brief Collect the word left open at the end of a file. */
+extern void finish_word(int file_index, const CountState *state, const WordToken *tok);
+
+/** \brief Collect the words of a byte range whose preceding state is unknown. */
+extern void scan_chunk_words(unsigned int id, int file_index, const unsigned char *buf, size_t len, WordChunk *wc);
+
+/** \brief Collect the words that cross the start of the next chunk of a file. */
+extern void merge_chunk_words(unsigned int id, int file_index, CountState *state, WordToken *tok, const WordChunk *wc);
+
+/** \brief Move the words collected by a worker to the global table. */
+extern void flush_words(unsigned int id);
+
+/** \brief Rank the words of every file and of all the files. */
+extern void rank_words(void);
+
+/** \brief Print the most frequent words. */
+extern void print_top_words(void);
+
+/** \brief Release the word tables. */
+extern void free_word_freq(void);
+
+#endif /* WORDFREQ_H_ */
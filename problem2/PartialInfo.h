@@ -15,7 +15,10 @@ struct PartialInfo{
     int file_id;
     int matrix_id;
     int order;
-    double ** matrix;
+    int ld;                 /* leading dimension: doubles from one row to the next, a multiple of 8 */
+    double * matrix;        /* first element, inside the aligned buffer of the file */
+    int count;              /* matrices of the piece: 1, or up to BATCH_LANES interleaved ones */
+    int interleaved;        /* 1 when matrix is the first element of a batch of interleaved matrices */
     double det;
 };
 
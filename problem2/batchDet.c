@@ -0,0 +1,204 @@
+/**
+ *  \file batchDet.c (implementation file)
+ *
+ *  \brief Problem name: Determinant of a square matrix
+ *
+ *  Determinants of BATCH_LANES small matrices of the same order at once. The matrices are interleaved
+ *  element by element: element (i, j) of the matrices of a batch is the run of BATCH_LANES doubles starting at
+ *  (i * order + j) * BATCH_LANES, one per matrix. Gaussian elimination then runs on all of them in step, every
+ *  loop over the lanes being a single vector operation (one AVX-512 vector, two AVX2 vectors), instead of
+ *  short vectors along rows of 4 to 32 columns and the per matrix overhead of the blocked factorization.
+ *
+ *  Partial pivoting is done per lane: the pivot rows are chosen with compares and selects and the rows are
+ *  swapped only in the lanes whose pivot they hold.
+ *
+ *  The same elimination is compiled for AVX-512 and for AVX2, the version the CPU supports being chosen on
+ *  first use (cpuid); compiled with -DNO_SIMD, or on another architecture, the portable version is used.
+ *
+ *  Definition of the operations carried out by the workers:
+ *     \li compute the determinants of a batch
+ *     \li name the selected kernel
+ *
+ *  \author Eduardo Santos and Pedro Bastos - April 2022
+ */
+
+#include <stdio.h>
+#include <stddef.h>
+#include <math.h>
+#include <pthread.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && !defined(NO_SIMD)
+#define HAVE_X86_SIMD
+#endif
+
+#include "probConst.h"
+#include "batchDet.h"
+
+/** \brief one element of the BATCH_LANES matrices of a batch, as a vector (GCC vector extension) */
+typedef double lanes __attribute__((vector_size(BATCH_LANES * sizeof(double))));
+
+/** \brief per lane mask, all ones where true, as produced by comparing two lanes vectors */
+typedef long long laneMask __attribute__((vector_size(BATCH_LANES * sizeof(double))));
+
+/** \brief kernel of a batch */
+typedef void (*batchFn)(int order, double *batch, double *det);
+
+/** \brief name of the selected kernel */
+static const char *selectedName = "portable";
+
+/** \brief flag which warrants that the kernel is selected exactly once */
+static pthread_once_t init = PTHREAD_ONCE_INIT;
+
+/** \brief select, lane by lane, x where the mask is set and y elsewhere */
+#define  laneSelect(mask, x, y)  ((lanes) (((laneMask) (x) & (mask)) | ((laneMask) (y) & ~(mask))))
+
+/**
+ * \brief Gaussian elimination with partial pivoting of a batch of interleaved matrices.
+ *
+ *  Inlined into each kernel, so that it is compiled for the instruction set of that kernel.
+ *
+ *  \param order matrix order
+ *  \param batch first element of the interleaved matrices, aligned to MATRIX_ALIGN bytes, overwritten
+ *  \param det where the BATCH_LANES determinants are stored, 0 for a singular matrix
+ */
+static inline __attribute__((always_inline)) void eliminate(int order, double *batch, double *det) {
+    lanes *a = (lanes *) batch;                                      /* a[i * order + j]: element (i, j) */
+    const laneMask absMask = (laneMask) {} + 0x7FFFFFFFFFFFFFFFLL;               /* clears the sign bit */
+    lanes sign = (lanes) {} + 1.0;
+    laneMask singular = (laneMask) {};
+
+    for (int k = 0; k < order; k++) {
+        lanes *rowK = a + (size_t) k * order;
+        lanes best = (lanes) ((laneMask) rowK[k] & absMask), pivot = (lanes) {} + k;
+        laneMask swapped = (laneMask) {};
+
+        /* pivot of each lane: the row of the largest magnitude in column k, kept as a double to select with */
+        for (int i = k + 1; i < order; i++) {
+            lanes v = (lanes) ((laneMask) a[(size_t) i * order + k] & absMask);
+            laneMask larger = v > best;
+
+            pivot = laneSelect(larger, (lanes) {} + i, pivot);
+            best = laneSelect(larger, v, best);
+        }
+
+        /* swap row k with the pivot row, in the lanes whose pivot it is */
+        for (int i = k + 1; i < order; i++) {
+            lanes *rowI = a + (size_t) i * order;
+            laneMask chosen = pivot == i;
+            int any = 0;
+
+            for (int l = 0; l < BATCH_LANES; l++)
+                any |= (int) chosen[l];
+            if (!any)
+                continue;
+
+            for (int j = k; j < order; j++) {
+                lanes x = rowK[j], y = rowI[j];
+
+                rowK[j] = laneSelect(chosen, y, x);
+                rowI[j] = laneSelect(chosen, x, y);
+            }
+            swapped |= chosen;
+        }
+
+        singular |= (best == 0.0);
+        sign = laneSelect(swapped, -sign, sign);
+
+        /* a division, as in computeDet, so that equal rows cancel exactly; not finite in a singular lane */
+        for (int i = k + 1; i < order; i++) {
+            lanes *rowI = a + (size_t) i * order;
+            lanes ratio = rowI[k] / rowK[k];
+
+            for (int j = k + 1; j < order; j++)
+                rowI[j] -= ratio * rowK[j];
+        }
+    }
+
+    /* product of the diagonal as a mantissa and an exponent, so that it neither overflows nor underflows midway */
+    for (int l = 0; l < BATCH_LANES; l++) {
+        double d = sign[l];
+        int exponent = 0, e;
+
+        for (int k = 0; k < order; k++) {
+            d = frexp(d * a[(size_t) k * order + k][l], &e);
+            exponent += e;
+        }
+
+        det[l] = singular[l] ? 0.0 : ldexp(d, exponent);
+    }
+}
+
+/**
+ * \brief Batch kernel compiled for the baseline instruction set.
+ */
+static void detPortable(int order, double *batch, double *det) {
+    eliminate(order, batch, det);
+}
+
+#ifdef HAVE_X86_SIMD
+
+/**
+ * \brief Batch kernel compiled for AVX2 and FMA: two vectors of four lanes.
+ */
+__attribute__((target("avx2,fma")))
+static void detAvx2(int order, double *batch, double *det) {
+    eliminate(order, batch, det);
+}
+
+/**
+ * \brief Batch kernel compiled for AVX-512: one vector of eight lanes.
+ */
+__attribute__((target("avx512f")))
+static void detAvx512(int order, double *batch, double *det) {
+    eliminate(order, batch, det);
+}
+
+#endif /* HAVE_X86_SIMD */
+
+/** \brief selected kernel */
+static batchFn selectedKernel = detPortable;
+
+/**
+ * \brief Select the kernel supported by the CPU.
+ */
+static void initialization(void) {
+#ifdef HAVE_X86_SIMD
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx512f")) {
+        selectedKernel = detAvx512;
+        selectedName = "avx512";
+    }
+    else if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        selectedKernel = detAvx2;
+        selectedName = "avx2";
+    }
+#endif
+}
+
+/**
+ * \brief Compute the determinants of a batch.
+ *
+ *  Operation carried out by the workers. The lanes of a batch that are not filled with matrices of the file
+ *  hold identity matrices.
+ *
+ *  \param order matrix order
+ *  \param batch first element of the BATCH_LANES interleaved matrices, overwritten
+ *  \param det where the BATCH_LANES determinants are stored, 0 for a singular matrix
+ */
+void computeDetBatch(int order, double *batch, double *det) {
+    pthread_once(&init, initialization);
+
+    selectedKernel(order, batch, det);
+}
+
+/**
+ * \brief Name of the batch kernel selected for this CPU.
+ *
+ *  \return "avx512", "avx2" or "portable".
+ */
+const char *batchKernelName(void) {
+    pthread_once(&init, initialization);
+
+    return selectedName;
+}
@@ -0,0 +1,23 @@
+/**
+ *  \file batchDet.h (interface file)
+ *
+ *  \brief Problem name: Determinant of a square matrix
+ *
+ *  Determinants of BATCH_LANES small matrices of the same order at once, stored interleaved so that each
+ *  lane of a vector works on a different matrix.
+ *
+ *  Definition of the operations carried out by the workers:
+ *     \li compute the determinants of a batch
+ *     \li name the selected kernel
+ *
+ *  \author Eduardo Santos and Pedro Bastos - April 2022
+ */
+
+#ifndef BATCH_DET_H_
+#define BATCH_DET_H_
+
+void computeDetBatch(int order, double *batch, double *det);
+
+const char *batchKernelName(void);
+
+#endif /* BATCH_DET_H_ */
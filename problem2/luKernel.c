@@ -0,0 +1,379 @@
+/**
+ *  \file luKernel.c (implementation file)
+ *
+ *  \brief Problem name: Determinant of a square matrix
+ *
+ *  Kernels of the trailing update of the LU factorization, A22 -= L21 * U12, for the rows first..last-1 and
+ *  the columns tile..end-1 of a panel col..next-1. Each kernel keeps a block of a few rows by a few vectors of
+ *  columns in registers while the panel is swept, so that every element of U loaded serves all the rows of
+ *  the block and the rows are loaded and stored once per panel:
+ *     \li avx512: 4 rows by 16 columns, with FMA;
+ *     \li avx2: 4 rows by 8 columns, with FMA;
+ *     \li sse2: 2 rows by 8 columns, multiply and subtract;
+ *     \li scalar: 2 rows by 8 columns in portable C, left to the compiler.
+ *
+ *  The kernel is chosen once from the CPU features (cpuid); compiled with -DNO_SIMD, or on another
+ *  architecture, the scalar kernel is always used. The rows left over are done one at a time and the columns
+ *  left over in scalar code.
+ *
+ *  Definition of the operations carried out by the workers:
+ *     \li update the trailing matrix
+ *     \li name the selected kernel
+ *
+ *  \author Eduardo Santos and Pedro Bastos - April 2022
+ */
+
+#include <stdio.h>
+#include <stddef.h>
+#include <pthread.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && !defined(NO_SIMD)
+#include <immintrin.h>
+#define HAVE_X86_SIMD
+#endif
+
+#include "luKernel.h"
+
+/** \brief kernel of the trailing update */
+typedef void (*updateFn)(double *matrix, int ld, int col, int next, int first, int last, int tile, int end);
+
+/** \brief name of the selected kernel */
+static const char *selectedName = "scalar";
+
+/** \brief flag which warrants that the kernel is selected exactly once */
+static pthread_once_t init = PTHREAD_ONCE_INIT;
+
+/**
+ * \brief Update the columns k..end-1 of a row, in scalar code.
+ *
+ *  \param row row being updated
+ *  \param matrix first element of the matrix
+ *  \param ld leading dimension of the matrix
+ *  \param col first column of the panel
+ *  \param next first column after the panel
+ *  \param k first column to update
+ *  \param end first column after the tile
+ */
+static void updateColumns(double *row, const double *matrix, int ld, int col, int next, int k, int end) {
+    for (; k < end; k++) {
+        double acc = row[k];
+
+        for (int j = col; j < next; j++)
+            acc -= row[j] * matrix[(size_t) j * ld + k];
+        row[k] = acc;
+    }
+}
+
+/**
+ * \brief Trailing update in portable C.
+ *
+ *  Two rows by eight columns in local arrays, which the compiler keeps in registers.
+ */
+static void updateScalar(double *matrix, int ld, int col, int next, int first, int last, int tile, int end) {
+    int i = first;
+
+    for (; i + 2 <= last; i += 2) {
+        double *rowA = matrix + (size_t) i * ld, *rowB = rowA + ld;
+        int k = tile;
+
+        for (; k + 8 <= end; k += 8) {
+            double accA[8], accB[8];
+
+            for (int u = 0; u < 8; u++) {
+                accA[u] = rowA[k + u];
+                accB[u] = rowB[k + u];
+            }
+            for (int j = col; j < next; j++) {
+                const double *pivotRow = matrix + (size_t) j * ld + k;
+                double ratioA = rowA[j], ratioB = rowB[j];
+
+                for (int u = 0; u < 8; u++) {
+                    accA[u] -= ratioA * pivotRow[u];
+                    accB[u] -= ratioB * pivotRow[u];
+                }
+            }
+            for (int u = 0; u < 8; u++) {
+                rowA[k + u] = accA[u];
+                rowB[k + u] = accB[u];
+            }
+        }
+        updateColumns(rowA, matrix, ld, col, next, k, end);
+        updateColumns(rowB, matrix, ld, col, next, k, end);
+    }
+
+    for (; i < last; i++)
+        updateColumns(matrix + (size_t) i * ld, matrix, ld, col, next, tile, end);
+}
+
+#ifdef HAVE_X86_SIMD
+
+/**
+ * \brief Trailing update with SSE2.
+ *
+ *  Two rows by eight columns in eight vectors of two doubles.
+ */
+__attribute__((target("sse2")))
+static void updateSse2(double *matrix, int ld, int col, int next, int first, int last, int tile, int end) {
+    int i = first;
+
+    for (; i + 2 <= last; i += 2) {
+        double *rowA = matrix + (size_t) i * ld, *rowB = rowA + ld;
+        int k = tile;
+
+        for (; k + 8 <= end; k += 8) {
+            __m128d a0 = _mm_loadu_pd(rowA + k), a1 = _mm_loadu_pd(rowA + k + 2);
+            __m128d a2 = _mm_loadu_pd(rowA + k + 4), a3 = _mm_loadu_pd(rowA + k + 6);
+            __m128d b0 = _mm_loadu_pd(rowB + k), b1 = _mm_loadu_pd(rowB + k + 2);
+            __m128d b2 = _mm_loadu_pd(rowB + k + 4), b3 = _mm_loadu_pd(rowB + k + 6);
+
+            for (int j = col; j < next; j++) {
+                const double *u = matrix + (size_t) j * ld + k;
+                __m128d u0 = _mm_loadu_pd(u), u1 = _mm_loadu_pd(u + 2);
+                __m128d u2 = _mm_loadu_pd(u + 4), u3 = _mm_loadu_pd(u + 6);
+                __m128d la = _mm_set1_pd(rowA[j]), lb = _mm_set1_pd(rowB[j]);
+
+                a0 = _mm_sub_pd(a0, _mm_mul_pd(la, u0));
+                a1 = _mm_sub_pd(a1, _mm_mul_pd(la, u1));
+                a2 = _mm_sub_pd(a2, _mm_mul_pd(la, u2));
+                a3 = _mm_sub_pd(a3, _mm_mul_pd(la, u3));
+                b0 = _mm_sub_pd(b0, _mm_mul_pd(lb, u0));
+                b1 = _mm_sub_pd(b1, _mm_mul_pd(lb, u1));
+                b2 = _mm_sub_pd(b2, _mm_mul_pd(lb, u2));
+                b3 = _mm_sub_pd(b3, _mm_mul_pd(lb, u3));
+            }
+
+            _mm_storeu_pd(rowA + k, a0);
+            _mm_storeu_pd(rowA + k + 2, a1);
+            _mm_storeu_pd(rowA + k + 4, a2);
+            _mm_storeu_pd(rowA + k + 6, a3);
+            _mm_storeu_pd(rowB + k, b0);
+            _mm_storeu_pd(rowB + k + 2, b1);
+            _mm_storeu_pd(rowB + k + 4, b2);
+            _mm_storeu_pd(rowB + k + 6, b3);
+        }
+        updateColumns(rowA, matrix, ld, col, next, k, end);
+        updateColumns(rowB, matrix, ld, col, next, k, end);
+    }
+
+    for (; i < last; i++)
+        updateColumns(matrix + (size_t) i * ld, matrix, ld, col, next, tile, end);
+}
+
+/**
+ * \brief Update a single row with AVX2 and FMA, eight columns at a time.
+ */
+__attribute__((target("avx2,fma")))
+static void updateRowAvx2(double *row, const double *matrix, int ld, int col, int next, int tile, int end) {
+    int k = tile;
+
+    for (; k + 8 <= end; k += 8) {
+        __m256d a0 = _mm256_loadu_pd(row + k), a1 = _mm256_loadu_pd(row + k + 4);
+
+        for (int j = col; j < next; j++) {
+            const double *u = matrix + (size_t) j * ld + k;
+            __m256d l = _mm256_broadcast_sd(row + j);
+
+            a0 = _mm256_fnmadd_pd(l, _mm256_loadu_pd(u), a0);
+            a1 = _mm256_fnmadd_pd(l, _mm256_loadu_pd(u + 4), a1);
+        }
+        _mm256_storeu_pd(row + k, a0);
+        _mm256_storeu_pd(row + k + 4, a1);
+    }
+    updateColumns(row, matrix, ld, col, next, k, end);
+}
+
+/**
+ * \brief Trailing update with AVX2 and FMA.
+ *
+ *  Four rows by eight columns in eight vectors of four doubles.
+ */
+__attribute__((target("avx2,fma")))
+static void updateAvx2(double *matrix, int ld, int col, int next, int first, int last, int tile, int end) {
+    int i = first;
+
+    for (; i + 4 <= last; i += 4) {
+        double *r0 = matrix + (size_t) i * ld, *r1 = r0 + ld, *r2 = r1 + ld, *r3 = r2 + ld;
+        int k = tile;
+
+        for (; k + 8 <= end; k += 8) {
+            __m256d a0 = _mm256_loadu_pd(r0 + k), a1 = _mm256_loadu_pd(r0 + k + 4);
+            __m256d b0 = _mm256_loadu_pd(r1 + k), b1 = _mm256_loadu_pd(r1 + k + 4);
+            __m256d c0 = _mm256_loadu_pd(r2 + k), c1 = _mm256_loadu_pd(r2 + k + 4);
+            __m256d d0 = _mm256_loadu_pd(r3 + k), d1 = _mm256_loadu_pd(r3 + k + 4);
+
+            for (int j = col; j < next; j++) {
+                const double *u = matrix + (size_t) j * ld + k;
+                __m256d u0 = _mm256_loadu_pd(u), u1 = _mm256_loadu_pd(u + 4);
+                __m256d l;
+
+                l = _mm256_broadcast_sd(r0 + j);
+                a0 = _mm256_fnmadd_pd(l, u0, a0);
+                a1 = _mm256_fnmadd_pd(l, u1, a1);
+                l = _mm256_broadcast_sd(r1 + j);
+                b0 = _mm256_fnmadd_pd(l, u0, b0);
+                b1 = _mm256_fnmadd_pd(l, u1, b1);
+                l = _mm256_broadcast_sd(r2 + j);
+                c0 = _mm256_fnmadd_pd(l, u0, c0);
+                c1 = _mm256_fnmadd_pd(l, u1, c1);
+                l = _mm256_broadcast_sd(r3 + j);
+                d0 = _mm256_fnmadd_pd(l, u0, d0);
+                d1 = _mm256_fnmadd_pd(l, u1, d1);
+            }
+
+            _mm256_storeu_pd(r0 + k, a0);
+            _mm256_storeu_pd(r0 + k + 4, a1);
+            _mm256_storeu_pd(r1 + k, b0);
+            _mm256_storeu_pd(r1 + k + 4, b1);
+            _mm256_storeu_pd(r2 + k, c0);
+            _mm256_storeu_pd(r2 + k + 4, c1);
+            _mm256_storeu_pd(r3 + k, d0);
+            _mm256_storeu_pd(r3 + k + 4, d1);
+        }
+        updateColumns(r0, matrix, ld, col, next, k, end);
+        updateColumns(r1, matrix, ld, col, next, k, end);
+        updateColumns(r2, matrix, ld, col, next, k, end);
+        updateColumns(r3, matrix, ld, col, next, k, end);
+    }
+
+    for (; i < last; i++)
+        updateRowAvx2(matrix + (size_t) i * ld, matrix, ld, col, next, tile, end);
+}
+
+/**
+ * \brief Update a single row with AVX-512, sixteen columns at a time.
+ */
+__attribute__((target("avx512f")))
+static void updateRowAvx512(double *row, const double *matrix, int ld, int col, int next, int tile, int end) {
+    int k = tile;
+
+    for (; k + 16 <= end; k += 16) {
+        __m512d a0 = _mm512_loadu_pd(row + k), a1 = _mm512_loadu_pd(row + k + 8);
+
+        for (int j = col; j < next; j++) {
+            const double *u = matrix + (size_t) j * ld + k;
+            __m512d l = _mm512_set1_pd(row[j]);
+
+            a0 = _mm512_fnmadd_pd(l, _mm512_loadu_pd(u), a0);
+            a1 = _mm512_fnmadd_pd(l, _mm512_loadu_pd(u + 8), a1);
+        }
+        _mm512_storeu_pd(row + k, a0);
+        _mm512_storeu_pd(row + k + 8, a1);
+    }
+    updateColumns(row, matrix, ld, col, next, k, end);
+}
+
+/**
+ * \brief Trailing update with AVX-512.
+ *
+ *  Four rows by sixteen columns in eight vectors of eight doubles.
+ */
+__attribute__((target("avx512f")))
+static void updateAvx512(double *matrix, int ld, int col, int next, int first, int last, int tile, int end) {
+    int i = first;
+
+    for (; i + 4 <= last; i += 4) {
+        double *r0 = matrix + (size_t) i * ld, *r1 = r0 + ld, *r2 = r1 + ld, *r3 = r2 + ld;
+        int k = tile;
+
+        for (; k + 16 <= end; k += 16) {
+            __m512d a0 = _mm512_loadu_pd(r0 + k), a1 = _mm512_loadu_pd(r0 + k + 8);
+            __m512d b0 = _mm512_loadu_pd(r1 + k), b1 = _mm512_loadu_pd(r1 + k + 8);
+            __m512d c0 = _mm512_loadu_pd(r2 + k), c1 = _mm512_loadu_pd(r2 + k + 8);
+            __m512d d0 = _mm512_loadu_pd(r3 + k), d1 = _mm512_loadu_pd(r3 + k + 8);
+
+            for (int j = col; j < next; j++) {
+                const double *u = matrix + (size_t) j * ld + k;
+                __m512d u0 = _mm512_loadu_pd(u), u1 = _mm512_loadu_pd(u + 8);
+                __m512d l;
+
+                l = _mm512_set1_pd(r0[j]);
+                a0 = _mm512_fnmadd_pd(l, u0, a0);
+                a1 = _mm512_fnmadd_pd(l, u1, a1);
+                l = _mm512_set1_pd(r1[j]);
+                b0 = _mm512_fnmadd_pd(l, u0, b0);
+                b1 = _mm512_fnmadd_pd(l, u1, b1);
+                l = _mm512_set1_pd(r2[j]);
+                c0 = _mm512_fnmadd_pd(l, u0, c0);
+                c1 = _mm512_fnmadd_pd(l, u1, c1);
+                l = _mm512_set1_pd(r3[j]);
+                d0 = _mm512_fnmadd_pd(l, u0, d0);
+                d1 = _mm512_fnmadd_pd(l, u1, d1);
+            }
+
+            _mm512_storeu_pd(r0 + k, a0);
+            _mm512_storeu_pd(r0 + k + 8, a1);
+            _mm512_storeu_pd(r1 + k, b0);
+            _mm512_storeu_pd(r1 + k + 8, b1);
+            _mm512_storeu_pd(r2 + k, c0);
+            _mm512_storeu_pd(r2 + k + 8, c1);
+            _mm512_storeu_pd(r3 + k, d0);
+            _mm512_storeu_pd(r3 + k + 8, d1);
+        }
+        updateColumns(r0, matrix, ld, col, next, k, end);
+        updateColumns(r1, matrix, ld, col, next, k, end);
+        updateColumns(r2, matrix, ld, col, next, k, end);
+        updateColumns(r3, matrix, ld, col, next, k, end);
+    }
+
+    for (; i < last; i++)
+        updateRowAvx512(matrix + (size_t) i * ld, matrix, ld, col, next, tile, end);
+}
+
+#endif /* HAVE_X86_SIMD */
+
+/** \brief selected kernel */
+static updateFn selectedKernel = updateScalar;
+
+/**
+ * \brief Select the kernel supported by the CPU.
+ */
+static void initialization(void) {
+#ifdef HAVE_X86_SIMD
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx512f")) {
+        selectedKernel = updateAvx512;
+        selectedName = "avx512";
+    }
+    else if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        selectedKernel = updateAvx2;
+        selectedName = "avx2";
+    }
+    else if (__builtin_cpu_supports("sse2")) {
+        selectedKernel = updateSse2;
+        selectedName = "sse2";
+    }
+#endif
+}
+
+/**
+ * \brief Update the trailing matrix with the panel.
+ *
+ *  Operation carried out by the workers. The rows first..last-1 get, in the columns tile..end-1, the product
+ *  of their multipliers in the columns col..next-1 by the rows col..next-1 of U subtracted.
+ *
+ *  \param matrix first element of the matrix
+ *  \param ld leading dimension of the matrix
+ *  \param col first column of the panel
+ *  \param next first column after the panel
+ *  \param first first row to update
+ *  \param last first row after the rows to update
+ *  \param tile first column to update
+ *  \param end first column after the columns to update
+ */
+void updateTrailing(double *matrix, int ld, int col, int next, int first, int last, int tile, int end) {
+    pthread_once(&init, initialization);
+
+    selectedKernel(matrix, ld, col, next, first, last, tile, end);
+}
+
+/**
+ * \brief Name of the kernel selected for this CPU.
+ *
+ *  \return "avx512", "avx2", "sse2" or "scalar".
+ */
+const char *kernelName(void) {
+    pthread_once(&init, initialization);
+
+    return selectedName;
+}
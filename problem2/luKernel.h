@@ -0,0 +1,23 @@
+/**
+ *  \file luKernel.h (interface file)
+ *
+ *  \brief Problem name: Determinant of a square matrix
+ *
+ *  Kernels of the trailing update of the LU factorization, one for each instruction set, the fastest one the
+ *  CPU supports being selected on first use.
+ *
+ *  Definition of the operations carried out by the workers:
+ *     \li update the trailing matrix
+ *     \li name the selected kernel
+ *
+ *  \author Eduardo Santos and Pedro Bastos - April 2022
+ */
+
+#ifndef LU_KERNEL_H_
+#define LU_KERNEL_H_
+
+void updateTrailing(double *matrix, int ld, int col, int next, int first, int last, int tile, int end);
+
+const char *kernelName(void);
+
+#endif /* LU_KERNEL_H_ */
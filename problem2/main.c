@@ -26,13 +26,22 @@
 #include <unistd.h>
 #include <string.h>
 #include <pthread.h>
+#include <math.h>
 #include "probConst.h"
 #include "sharedRegion.h"
 #include "PartialInfo.h"
+#include "luKernel.h"
+#include "batchDet.h"
 
 PartialInfo **finalInfo;
 int *totalMatrices;
 
+/** \brief 1 when the determinants of small matrices are computed in batches (option -b) */
+int batchMode = 0;
+
+/** \brief index in argv of the first file name */
+static int firstFile = 0;
+
 /** \brief process the called command. */
 static int process_command(int argc, char *argv[]);
 
@@ -47,49 +56,114 @@ static void *worker (void *par);
 struct timespec start, finish;                                                                                  /* time limits */
 
 /**
- * \brief Compute determinant
+ * \brief Factorize a panel of columns, with partial pivoting.
+ *
+ *  Unblocked LU of the columns col..col+width-1 of the rows col..order-1: the multipliers overwrite the
+ *  entries below the diagonal and only the columns of the panel are updated. The rows are swapped whole.
  *
  *  \param order matrix order
- *  \param matrix matrix array
+ *  \param ld leading dimension of the matrix
+ *  \param matrix first element of the matrix
+ *  \param col first column of the panel
+ *  \param width number of columns of the panel
+ *  \param sign sign of the determinant, flipped at each row swap
  *
- *  \return matrix's determinant
+ *  \return 1 on success, 0 if the matrix is singular
  */
-double computeDet(int order, double **matrix) {
-    double ratio;
-    double det = 1;
-    int i, j, k;
-
-    //t0 = ((double) clock ()) / CLOCKS_PER_SEC;
-
-    //Here we are using Gauss Elimination
-    //Technique for transforming matrix to
-    //upper triangular matrix
-
-    // Applying Gauss Elimination         
-    for (i = 0; i < order; i++)
-    {
-        if (matrix[i][i] == 0.0)
-        {
-            printf("Mathematical Error!");
-            exit(0);
+static int factorPanel(int order, int ld, double *matrix, int col, int width, int *sign) {
+    for (int j = col; j < col + width; j++) {
+        double *pivotRow = matrix + (size_t) j * ld;
+        double best = fabs(pivotRow[j]);
+        int pivot = j;
+
+        for (int i = j + 1; i < order; i++)
+            if (fabs(matrix[(size_t) i * ld + j]) > best) {
+                best = fabs(matrix[(size_t) i * ld + j]);
+                pivot = i;
+            }
+        if (best == 0.0)
+            return 0;
+
+        if (pivot != j) {
+            double *other = matrix + (size_t) pivot * ld;
+
+            for (int k = 0; k < order; k++) {
+                double tmp = pivotRow[k];
+                pivotRow[k] = other[k];
+                other[k] = tmp;
+            }
+            *sign = -*sign;
         }
-        for (j = i + 1; j < order; j++)
-        {
-            ratio = matrix[j][i] / matrix[i][i];
 
-            for (k = 0; k < order; k++)
-            {
-                    matrix[j][k] = matrix[j][k] - ratio * matrix[i][k];
+        for (int i = j + 1; i < order; i++) {
+            double *row = matrix + (size_t) i * ld;
+            double ratio = row[j] /= pivotRow[j];
+
+            for (int k = j + 1; k < col + width; k++)
+                row[k] -= ratio * pivotRow[k];
+        }
+    }
+
+    return 1;
+}
+
+/**
+ * \brief Compute determinant
+ *
+ *  Blocked right-looking LU factorization with partial pivoting. For each panel of LU_BLOCK columns: the
+ *  panel is factorized, the rows of U to its right are solved with its unit lower triangle, and the trailing
+ *  matrix is updated with the product of the multipliers below the panel and those rows, LU_TILE columns
+ *  at a time so that the rows of U being used stay in cache, by the SIMD kernel selected for the CPU (see
+ *  luKernel.c). The determinant is the product of the diagonal of U, with the sign of the row swaps. The
+ *  matrix is overwritten with its factors; a zero column below the diagonal means the matrix is singular.
+ *
+ *  The matrix is stored by rows, row i starting ld doubles after row i - 1.
+ *
+ *  \param order matrix order
+ *  \param ld leading dimension of the matrix
+ *  \param matrix first element of the matrix
+ *
+ *  \return matrix's determinant, 0 for a singular matrix
+ */
+double computeDet(int order, int ld, double *matrix) {
+    double det;
+    int sign = 1;
+    int exponent = 0, e;
+
+    for (int col = 0; col < order; col += LU_BLOCK) {
+        int width = (order - col < LU_BLOCK) ? order - col : LU_BLOCK;
+        int next = col + width;
+
+        if (!factorPanel(order, ld, matrix, col, width, &sign))
+            return 0.0;
+
+        /* rows of U right of the panel: forward substitution with the unit lower triangle of the panel */
+        for (int j = col; j < next; j++)
+            for (int i = j + 1; i < next; i++) {
+                double *row = matrix + (size_t) i * ld;
+                const double *pivotRow = matrix + (size_t) j * ld;
+                double ratio = row[j];
+
+                for (int k = next; k < order; k++)
+                    row[k] -= ratio * pivotRow[k];
             }
+
+        /* trailing update, A22 -= L21 * U12, one tile of columns at a time */
+        for (int tile = next; tile < order; tile += LU_TILE) {
+            int end = (order - tile < LU_TILE) ? order : tile + LU_TILE;
+
+            updateTrailing(matrix, ld, col, next, next, order, tile, end);
         }
     }
 
-    // Finding determinant by multiplying
-    // elements in principal diagonal elements 
-    for (i = 0; i < order; i++)
-        det = det * matrix[i][i];
+    /* product of the diagonal as a mantissa and an exponent, so that it neither overflows nor underflows midway */
+    det = sign;
+    for (int i = 0; i < order; i++) {
+        det = frexp(det * matrix[(size_t) i * ld + i], &e);
+        exponent += e;
+    }
 
-    return det;
+    return ldexp(det, exponent);
 }
 
 /**
@@ -108,7 +182,7 @@ int main(int argc, char * argv[]) {
 
     // process the command and act according to it
     command_result = process_command(argc, argv);
-    if (command_result != EXIT_SUCCESS)
+    if (command_result != EXIT_SUCCESS || firstFile == 0)                                         /* error or help */
         return command_result;
 
     clock_gettime (CLOCK_MONOTONIC_RAW, &start);                                                       /* begin of measurement */
@@ -122,8 +196,8 @@ int main(int argc, char * argv[]) {
     for (int t = 0; t < threads; t++)
         workers[t] = t;
     
-    int numberOfFiles = argc - 2;
-    storeFileNames(numberOfFiles, argv);
+    int numberOfFiles = argc - firstFile;
+    storeFileNames(numberOfFiles, argv + firstFile);
 
     /* --------------- THREADS --------------- */
     for (int t = 0; t < threads; t++){
@@ -155,7 +229,18 @@ int main(int argc, char * argv[]) {
 
     clock_gettime (CLOCK_MONOTONIC_RAW, &finish);                                                        /* end of measurement */
 
-    printf ("\nElapsed time = %.6f s\n",  (finish.tv_sec - start.tv_sec) / 1.0 + (finish.tv_nsec - start.tv_nsec) / 1000000000.0);
+    double elapsed = (finish.tv_sec - start.tv_sec) / 1.0 + (finish.tv_nsec - start.tv_nsec) / 1000000000.0;
+    double flops = 0.0;                                           /* 2/3 n^3 floating point operations a matrix */
+
+    for (int i = 0; i < numberOfFiles; i++)
+        if (totalMatrices[i] > 0)
+            flops += totalMatrices[i] * 2.0 / 3.0 * pow(finalInfo[i][0].order, 3);
+
+    printf ("\nElapsed time = %.6f s\n",  elapsed);
+    printf ("Throughput = %.3f GFLOP/s, %s kernel\n", flops / elapsed / 1000000000.0, kernelName());
+    if (batchMode)
+        printf ("Batches of %d matrices of order up to %d, %s kernel\n", BATCH_LANES, BATCH_MAX_ORDER,
+                batchKernelName());
 
     return 0;
 
@@ -174,9 +259,17 @@ static void *worker (void *par) {
     printf("Thread %d created \n", id);
 
     PartialInfo info; 
+    double dets[BATCH_LANES];
 
     while (getVal(id, &info) != 2) {
-        info.det = computeDet(info.order, info.matrix);
+        if (info.interleaved) {
+            computeDetBatch(info.order, info.matrix, dets);
+            for (int m = 0; m < info.count; m++)
+                printf("det for file %d matrix %d: %.3e \n", info.file_id, info.matrix_id + m, dets[m]);
+            continue;
+        }
+
+        info.det = computeDet(info.order, info.ld, info.matrix);
         printf("det for file %d matrix %d: %.3e \n", info.file_id, info.matrix_id, info.det);
     }
 
@@ -194,7 +287,7 @@ static int process_command(int argc, char *argv[]) {
     int val = -1;             /* numeric value (initialized to -1 by default) */
     opterr = 0;
     do
-    { switch ((opt = getopt (argc, argv, "f:n:h"))) { 
+    { switch ((opt = getopt (argc, argv, "+f:n:hb"))) { 
         case 'f': /* file name */
                 if (optarg[0] == '-')
                     { fprintf (stderr, "%s: file name is missing\n", basename (argv[0]));
@@ -202,6 +295,10 @@ static int process_command(int argc, char *argv[]) {
                     return EXIT_FAILURE;
                     }
                     fName = optarg;
+                    firstFile = optind - 1;                      /* the other file names follow the first one */
+                    break;
+        case 'b': /* batch mode */
+                    batchMode = 1;
                     break;
         case 'n': /* numeric argument */
                     if (atoi (optarg) <= 0)
@@ -228,6 +325,12 @@ static int process_command(int argc, char *argv[]) {
         return EXIT_FAILURE;
     }
 
+    if (firstFile == 0){ 
+        fprintf (stderr, "%s: file name is missing\n", basename (argv[0]));
+        printUsage (basename (argv[0]));
+        return EXIT_FAILURE;
+    }
+
     int o; /* counting variable */
 
     printf ("File name = %s\n", fName);
@@ -248,6 +351,7 @@ static void printUsage (char *cmdName)
   fprintf (stderr, "\nSynopsis: %s OPTIONS [filename / positive number]\n"
            "  OPTIONS:\n"
            "  -h      --- print this help\n"
+           "  -b      --- compute the determinants of small matrices in batches (before -f)\n"
            "  -f      --- filename\n"
            "  -n      --- positive number\n", cmdName);
 }
\ No newline at end of file
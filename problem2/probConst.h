@@ -17,4 +17,19 @@
 /** \brief number of worker*/
 #define  N                                   1
 
+/** \brief alignment of the matrix buffers and of every row, in bytes (a cache line, a full AVX-512 vector) */
+#define  MATRIX_ALIGN                        64
+
+/** \brief width of the panels of the blocked LU factorization, in columns */
+#define  LU_BLOCK                            64
+
+/** \brief width of the column tiles of the trailing update, in columns */
+#define  LU_TILE                             256
+
+/** \brief matrices whose determinants are computed together in batch mode, one per lane of an AVX-512 vector */
+#define  BATCH_LANES                         8
+
+/** \brief largest order of the matrices of a file computed in batches */
+#define  BATCH_MAX_ORDER                     32
+
 #endif /* PROBCONST_H_ */
\ No newline at end of file
@@ -3,6 +3,11 @@
  *
  *  \brief Problem name: Determinant of a square matrix
  *
+ *  The matrices of a file are loaded into a single buffer aligned to MATRIX_ALIGN bytes, one after the other,
+ *  each row padded to a leading dimension that keeps every row aligned as well. In batch mode, the matrices of
+ *  a file of order up to BATCH_MAX_ORDER are instead interleaved by groups of BATCH_LANES (see batchDet.c),
+ *  the lanes of the last group left over holding identity matrices, and are handed out a group at a time.
+ *
  *  Definition of the operations carried out by the workers:
  *     \li add the files to be processed
  *     \li get a piece of data to be processed
@@ -17,12 +22,16 @@
 #include <pthread.h>
 #include <errno.h>
 #include <stdbool.h>
+#include <string.h>
 #include "probConst.h"
 #include "PartialInfo.h"
 
 /** \brief worker status */
 extern int *statusWorker;
 
+/** \brief 1 when the determinants of small matrices are computed in batches */
+extern int batchMode;
+
 extern PartialInfo **finalInfo;
 extern int *totalMatrices;
 
@@ -38,8 +47,57 @@ static int currIndex = 0;
 static bool finishedFiles = false;
 static int c = 0;
 
-PartialInfo **finalInfo;
-int *totalMatrices;
+/** \brief aligned buffer holding every matrix of each file */
+static double **matrixData;
+
+/**
+ *  \brief Leading dimension of the rows of a matrix.
+ *
+ *  \param order matrix order
+ *
+ *  \return order rounded up to a whole number of MATRIX_ALIGN bytes
+ */
+static int leadingDimension(int order) {
+    int perLine = MATRIX_ALIGN / sizeof(double);
+
+    return (order + perLine - 1) / perLine * perLine;
+}
+
+/**
+ *  \brief Load the matrices of a file interleaved by groups of BATCH_LANES.
+ *
+ *  Element (i, j) of the matrices of a group is the run of BATCH_LANES doubles starting at
+ *  (i * order + j) * BATCH_LANES.
+ *
+ *  \param fp file, positioned at the first matrix
+ *  \param nMatrices number of matrices of the file
+ *  \param order matrix order
+ *  \param data aligned buffer of the groups
+ */
+static void loadInterleaved(FILE *fp, int nMatrices, int order, double *data) {
+    size_t elements = (size_t) order * order;                                        /* doubles of a matrix */
+    size_t groupSize = elements * BATCH_LANES;                                        /* doubles of a group */
+    double *rows = malloc(groupSize * sizeof(double));
+
+    if (rows == NULL) {
+        printf("Error! Not enough memory for the matrices of %s.\n", files[currFile]);
+        exit(1);
+    }
+
+    for (int first = 0; first < nMatrices; first += BATCH_LANES) {
+        int count = (nMatrices - first < BATCH_LANES) ? nMatrices - first : BATCH_LANES;
+        double *group = data + (size_t) first / BATCH_LANES * groupSize;
+
+        fread(rows, sizeof(double), count * elements, fp);
+
+        for (int m = 0; m < BATCH_LANES; m++)
+            for (size_t e = 0; e < elements; e++)
+                group[e * BATCH_LANES + m] = (m < count) ? rows[m * elements + e]
+                                                         : (e % (order + 1) == 0);          /* identity lane */
+    }
+
+    free(rows);
+}
 
 /**
  *  \brief Open next file and process it
@@ -61,36 +119,49 @@ void openNextFile() {
 
     int nMatrices = 0;
     int order = 0;
-    int size = 0;
+    int ld;
+    size_t size;
+    int interleaved;
 
     fread(&nMatrices, sizeof(int), 1, file[currFile]);
     fread(&order, sizeof(int), 1, file[currFile]);
 
-    size = order * order;
+    interleaved = batchMode && order <= BATCH_MAX_ORDER;
+    ld = interleaved ? order : leadingDimension(order);
+    size = (size_t) order * ld;                                                          /* doubles of a matrix */
     totalMatrices[currFile] = nMatrices;
     finalInfo[currFile] = malloc(sizeof(*finalInfo[0])*nMatrices);
-    
+
+    /* one aligned buffer for every matrix of the file, the padding of the rows zeroed; whole groups if interleaved */
+    size_t stored = interleaved ? (size_t) (nMatrices + BATCH_LANES - 1) / BATCH_LANES * BATCH_LANES : (size_t) nMatrices;
+
+    if (posix_memalign((void **) &matrixData[currFile], MATRIX_ALIGN, stored * size * sizeof(double)) != 0) {
+        printf("Error! Not enough memory for the matrices of %s.\n", files[currFile]);
+        exit(1);
+    }
+    if (ld != order)
+        memset(matrixData[currFile], 0, nMatrices * size * sizeof(double));
+
     for (int i = 0; i < nMatrices; i++) {
         finalInfo[currFile][i].file_id = currFile + 1;
         finalInfo[currFile][i].matrix_id = i + 1;
         finalInfo[currFile][i].order = order;
-        finalInfo[currFile][i].matrix = malloc(order * sizeof(double *));
-
-        for(int ii = 0; ii < order; ii++) {
-            finalInfo[currFile][i].matrix[ii] = malloc(order * sizeof(double));
-            fread(finalInfo[currFile][i].matrix[ii], sizeof(double), order, file[currFile]);
-        }
-        
-        // for(int x = 0; x < order; x++)
-        // {
-        //     for(int j = 0; j < order; j++)
-        //     {
-        //         printf("%7.2f\t",finalInfo[currFile][i].matrix[x][j]);
-        //     }
-        //     printf("\n");
-        // }
+        finalInfo[currFile][i].ld = ld;
+        finalInfo[currFile][i].count = 1;
+        finalInfo[currFile][i].interleaved = interleaved;
+        finalInfo[currFile][i].matrix = matrixData[currFile]
+                                        + (interleaved ? (size_t) i / BATCH_LANES * BATCH_LANES : (size_t) i) * size;
     }
-    
+
+    /* rows without padding are read in one go, the others one row at a time */
+    if (interleaved)
+        loadInterleaved(file[currFile], nMatrices, order, matrixData[currFile]);
+    else if (ld == order)
+        fread(matrixData[currFile], sizeof(double), nMatrices * size, file[currFile]);
+    else
+        for (size_t row = 0; row < (size_t) nMatrices * order; row++)
+            fread(matrixData[currFile] + row * ld, sizeof(double), order, file[currFile]);
+
     return;
 }
 
@@ -105,13 +176,14 @@ void storeFileNames(int filesNumber, char * fileNames[]) {
     numberOfFiles = filesNumber;                     //number of files
     files = malloc(sizeof(char *)*numberOfFiles);
 
-    for (int i = 2; i < 2 + filesNumber; i++){
+    for (int i = 0; i < filesNumber; i++){
         files[c] = fileNames[i];
         c++;
     }
 
     finalInfo = malloc(sizeof(*finalInfo)*numberOfFiles);
     totalMatrices = malloc(sizeof(int)*numberOfFiles);
+    matrixData = malloc(sizeof(*matrixData)*numberOfFiles);
 
     openNextFile();
 }
@@ -152,8 +224,13 @@ int getVal(int threadID, PartialInfo *info) {
         //printf("reading data\n");
         // Writing to the variables we need to
         (*info) = finalInfo[currFile][currIndex];
-        
-        currIndex++;
+
+        /* a whole group of interleaved matrices at once */
+        if (info->interleaved)
+            info->count = (totalMatrices[currFile] - currIndex < BATCH_LANES) ? totalMatrices[currFile] - currIndex
+                                                                               : BATCH_LANES;
+
+        currIndex += info->count;
         status = 0;
     }
     else {